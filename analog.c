@@ -5,10 +5,29 @@
  *
  * Provides the global variables and service routine for analog to digital
  * conversion. The service routine should be run from the 1kHz system 
- * interrupt.  It uses a counter to execute at 50 hz, every 20ms.
+ * interrupt.  By default it reads all channels every 50ms.
  * A/D values are returned in globals an0 thru an7. Only 7 channels are 
  * available; an7 is a dummy.
  *
+ * Each channel has its own sample period, analog_set_rate(), and can be
+ * turned off with analog_set_mask(). Only the channels that are due are
+ * read, so the time spent in the interrupt follows what is used.
+ *
+ * While a scope capture runs (analog_scope.c) its channels are also read
+ * every tick and handed over raw.
+ *
+ * Threshold events on channels (analog_event.c) are checked after each
+ * new sample of the channel.
+ *
+ * Each scan is also published as an analog_frame holding all channels,
+ * the sysclock time of the scan and a scan number. Tasks that use more
+ * than one channel should take a copy with analog_read_frame(), which
+ * never mixes two scans and does not disable interrupts.
+ *
+ * Each channel can be filtered, see analog_filter.c, and converted to
+ * engineering units by a table, see analog_lut.c. an0 thru an7 and the
+ * frame hold the filtered and converted values.
+ *
  * <b>History</b>
  *
  * 01 Oct 2004 dpa - Created
@@ -16,6 +35,14 @@
  * 19 Feb 2005 dpa - Added dummy an8 channel in case loading pipeline is
  *                   corrupting an0. Use an8 to load pipeline instead.
  *
+ * 18 Oct 2026 agt - Timestamped analog_frame, updated under a sequence
+ *                   count and read with analog_read_frame(). Per-channel
+ *                   sample periods and an enable mask replace the fixed
+ *                   A2D_MOD scan. Samples pass through the per-channel
+ *                   filters and conversion tables, the scope capture
+ *                   channels are read every tick and threshold events
+ *                   are checked on fresh samples.
+ *
  * \todo Rename globals to new naming scheme
  * \todo Modify code to work at any clock rate
  *
@@ -40,37 +67,180 @@
 		
 */
 
-/* use 20 at 16MHz */
+#include "analog.h"
+
+/* default sample period in ms, use 20 at 16MHz */
 #define A2D_MOD 50
 
+/* A/D converter, reading address n starts a conversion of input n and
+   returns the result of the previous conversion */
+#define A2D_BASE ((volatile unsigned char *)0xf00000)
+
+/**
+ * Sample period of each channel in 1 ms ticks
+ */
+int analog_rates[ANALOG_CHANNELS] = {
+	A2D_MOD, A2D_MOD, A2D_MOD, A2D_MOD, A2D_MOD, A2D_MOD, A2D_MOD, A2D_MOD
+};
+
+/**
+ * Ticks until each channel is next read
+ */
+int analog_count[ANALOG_CHANNELS];
+
 /**
- * Service interval counter
+ * Channels that are read, bit n = channel n
  */
-int a2d_mod;
+volatile int analog_mask = 0xff;
+
+/**
+ * A/D input selected to read each channel; channel 7 repeats input 0.
+ */
+static const unsigned char analog_sel[ANALOG_CHANNELS] = {
+	1, 2, 3, 4, 5, 6, 7, 0
+};
 
 /**
  * Current A to D value
  */
 volatile int an0,an1,an2,an3,an4,an5,an6,an7,an8;
 
+static volatile int *const analog_an[ANALOG_CHANNELS] = {
+	&an0, &an1, &an2, &an3, &an4, &an5, &an6, &an7
+};
+
+/**
+ * Latest scan of all channels. Read it with analog_read_frame().
+ */
+volatile struct analog_frame analog_frame;
+
 /**
- * Loads the global A to D variables with the current values from the
- * analog sample buffer each time the modulo 20 counter reaches zero.
+ * Frame update count, odd while analog_frame is being written
+ */
+volatile unsigned long analog_lock;
+
+/**
+ * Reads the channels that are due, filters them and loads the global
+ * A to D variables and the frame. The due channels are read through the
+ * converter pipeline: each read selects the next channel and returns
+ * the one before, so n channels take n+2 reads.
  */
 void analog_service()
 {
-	if (--a2d_mod <= 0) {
-		a2d_mod = A2D_MOD;
-
-		an8 = *(unsigned char *)0xf00000;
-		an8 = *(unsigned char *)0xf00001;
-		an0 = *(unsigned char *)0xf00002;
-		an1 = *(unsigned char *)0xf00003;
-		an2 = *(unsigned char *)0xf00004;
-		an3 = *(unsigned char *)0xf00005;
-		an4 = *(unsigned char *)0xf00006;
-		an5 = *(unsigned char *)0xf00007;
-		an6 = *(unsigned char *)0xf00000;
-		an7 = *(unsigned char *)0xf00000;
-	} 
+	extern long sysclock;
+	extern volatile int analog_scope_mask;
+	extern volatile int analog_event_mask;
+	extern const short *volatile analog_luts[];
+	const short *lut;
+	volatile int *v;
+	int raw[ANALOG_CHANNELS];
+	int due, rd, last, x, i;
+
+	due = 0;
+	for (i = 0; i < ANALOG_CHANNELS; i++) {
+		if ((analog_mask & (1 << i)) && (--analog_count[i] <= 0)) {
+			analog_count[i] = analog_rates[i];
+			due |= 1 << i;
+		}
+	}
+
+	rd = due | analog_scope_mask;
+	if (rd == 0)
+		return;
+
+	an8 = A2D_BASE[0];                 /* load pipeline */
+	last = -1;
+	for (i = 0; i < ANALOG_CHANNELS; i++) {
+		if (rd & (1 << i)) {
+			x = A2D_BASE[analog_sel[i]];
+			if (last < 0)
+				an8 = x;                   /* dummy */
+			else
+				raw[last] = x;
+			last = i;
+		}
+	}
+	raw[last] = A2D_BASE[0];
+
+	if (analog_scope_mask)
+		analog_scope_sample(raw);
+
+	if (due == 0)
+		return;
+
+	analog_lock++;                     /* frame is changing */
+	v = analog_frame.value;
+	for (i = 0; i < ANALOG_CHANNELS; i++) {
+		if (due & (1 << i)) {
+			x = analog_filter_run(i, raw[i]);
+			if ((lut = analog_luts[i]) != 0)
+				x = lut[x];
+			*analog_an[i] = v[i] = x;
+		}
+	}
+	analog_frame.time = sysclock;
+	analog_frame.fresh = due;
+	analog_frame.seq++;
+	analog_lock++;                     /* frame is consistent */
+
+	if (due & analog_event_mask)
+		analog_event_check(due, v);
+}
+
+
+/**
+ * Set the sample period of a channel. Filters on the channel run at
+ * this rate. The channel is next read on the following tick.
+ *
+ * @param ch Channel, 0 to 7
+ * @param ms Period in 1 ms ticks, 1 = 1 kHz
+ * @return 0 if ok, -1 if out of range
+ */
+int analog_set_rate(int ch, int ms)
+{
+	if ((ch < 0) || (ch >= ANALOG_CHANNELS) || (ms < 1))
+		return -1;
+
+	analog_rates[ch] = ms;
+	analog_count[ch] = 1;
+	return 0;
+}
+
+
+/**
+ * Choose which channels are read. Channels that are off keep their last
+ * value and cost no interrupt time.
+ *
+ * @param mask Bit n set to read channel n
+ */
+void analog_set_mask(int mask)
+{
+	analog_mask = mask & 0xff;
+}
+
+
+/**
+ * Copy the latest A/D scan. All channels in the copy come from the same
+ * scan. If the service updates the frame during the copy, the copy is
+ * simply done again.
+ *
+ * @param f Where to put the copy
+ * @return Scan number of the copy, which a task can compare with an
+ * earlier one to see whether there is new data
+ */
+unsigned long analog_read_frame(struct analog_frame *f)
+{
+	unsigned long lock;
+	int i;
+
+	do {
+		lock = analog_lock;
+		f->time = analog_frame.time;
+		f->seq = analog_frame.seq;
+		f->fresh = analog_frame.fresh;
+		for (i = 0; i < ANALOG_CHANNELS; i++)
+			f->value[i] = analog_frame.value[i];
+	} while ((lock & 1) || (lock != analog_lock));
+
+	return f->seq;
 }
@@ -0,0 +1,228 @@
+/**
+ * \file analog_event.c
+ * \brief A/D threshold crossing events
+ *
+ * A task registers a channel with a high and a low threshold. After each
+ * new (filtered) sample of the channel analog_service() checks it. The
+ * event goes high when the value reaches the high threshold and low
+ * again when it falls to the low one, so noise between the two does not
+ * cause repeated events. On each crossing the service counts it, stores
+ * the edge in an optional flag and calls an optional function. Nothing
+ * happens between crossings. For example, to stop at a cliff:
+ *
+ *   volatile int cliff;
+ *
+ *   analog_event(2, 180, 150, &cliff, 0);
+ *   ...
+ *   if (cliff == ANALOG_RISE) { stop_motors(); cliff = 0; }
+ *
+ * or block a behavior task until the edge with analog_event_wait(),
+ * which only checks a counter each time it runs (the scheduler has no
+ * sleep/wake, so waiting tasks still run through defer()). The function
+ * is called from the 1 kHz interrupt and must be short.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "analog.h"
+
+/**
+ * One threshold event
+ */
+struct analog_event
+{
+	int ch;                         /* channel, -1 = free */
+	int high, low;                  /* thresholds */
+	int state;                      /* ANALOG_RISE, ANALOG_FALL, 0 = none */
+	volatile int *flag;             /* set to the edge, or 0 */
+	void (*func)(int id, int edge); /* called on an edge, or 0 */
+	volatile unsigned long rises, falls;
+};
+
+struct analog_event analog_events[ANALOG_EVENTS] = {
+	{ -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }, { -1 }
+};
+
+/**
+ * Channels with events, bit n = channel n
+ */
+volatile int analog_event_mask;
+
+
+/**
+ * Recompute analog_event_mask
+ */
+static void analog_event_update()
+{
+	int i, mask;
+
+	for (i = mask = 0; i < ANALOG_EVENTS; i++)
+		if (analog_events[i].ch >= 0)
+			mask |= 1 << analog_events[i].ch;
+	analog_event_mask = mask;
+}
+
+
+/**
+ * Register a threshold event.
+ *
+ * @param ch Channel, 0 to 7
+ * @param high Value at which the event goes high (ANALOG_RISE)
+ * @param low Value at which it goes low again (ANALOG_FALL), below high
+ * @param flag If not 0, set to ANALOG_RISE or ANALOG_FALL on each edge
+ * @param func If not 0, called with the event id and edge on each edge,
+ * from the interrupt
+ * @return Event id, or -1 if none is free or a parameter is bad
+ */
+int analog_event(int ch, int high, int low, volatile int *flag,
+	void (*func)(int id, int edge))
+{
+	struct analog_event *e;
+	int i;
+
+	if ((ch < 0) || (ch >= ANALOG_CHANNELS) || (low >= high))
+		return -1;
+
+	for (i = 0; i < ANALOG_EVENTS; i++)
+		if (analog_events[i].ch < 0)
+			break;
+	if (i == ANALOG_EVENTS)
+		return -1;
+
+	e = &analog_events[i];
+	e->high = high;
+	e->low = low;
+	e->state = 0;                   /* set by the first sample */
+	e->flag = flag;
+	e->func = func;
+	e->rises = e->falls = 0;
+	e->ch = ch;                     /* now live */
+	analog_event_update();
+
+	return i;
+}
+
+
+/**
+ * Remove a threshold event.
+ *
+ * @param id Event id from analog_event()
+ */
+void analog_event_remove(int id)
+{
+	if ((id < 0) || (id >= ANALOG_EVENTS))
+		return;
+
+	analog_events[id].ch = -1;
+	analog_event_update();
+}
+
+
+/**
+ * Current state of an event.
+ *
+ * @return ANALOG_RISE if above the high threshold, ANALOG_FALL if below
+ * the low one, 0 before the first sample or for a bad id
+ */
+int analog_event_state(int id)
+{
+	if ((id < 0) || (id >= ANALOG_EVENTS) || (analog_events[id].ch < 0))
+		return 0;
+	return analog_events[id].state;
+}
+
+
+/**
+ * Wait in a defer() loop for the next edge of an event.
+ *
+ * @param id Event id from analog_event()
+ * @param edges ANALOG_RISE, ANALOG_FALL or both
+ * @param timeout Longest wait in ms, 0 = no limit
+ * @return The edge seen, or 0 on timeout or for a bad id
+ */
+int analog_event_wait(int id, int edges, long timeout)
+{
+	extern long sysclock;
+	struct analog_event *e;
+	unsigned long rises, falls;
+	long t;
+
+	if ((id < 0) || (id >= ANALOG_EVENTS) || (analog_events[id].ch < 0))
+		return 0;
+
+	e = &analog_events[id];
+	rises = e->rises;
+	falls = e->falls;
+	t = sysclock + timeout;
+
+	for (;;) {
+		if ((edges & ANALOG_RISE) && (e->rises != rises))
+			return ANALOG_RISE;
+		if ((edges & ANALOG_FALL) && (e->falls != falls))
+			return ANALOG_FALL;
+		if (timeout && (sysclock >= t))
+			return 0;
+		defer();
+	}
+}
+
+
+/**
+ * Check the events of the channels just sampled. Called by
+ * analog_service() when fresh includes a channel in analog_event_mask.
+ *
+ * @param fresh Channels sampled, bit n = channel n
+ * @param v Values of all channels
+ */
+void analog_event_check(int fresh, volatile int *v)
+{
+	struct analog_event *e;
+	int i, x, edge;
+
+	for (i = 0; i < ANALOG_EVENTS; i++) {
+		e = &analog_events[i];
+		if ((e->ch < 0) || !(fresh & (1 << e->ch)))
+			continue;
+
+		x = v[e->ch];
+		edge = 0;
+		if (e->state == 0) {            /* first sample, no edge */
+			e->state = (x >= e->high) ? ANALOG_RISE : ANALOG_FALL;
+			continue;
+		}
+		if ((e->state == ANALOG_FALL) && (x >= e->high)) {
+			edge = ANALOG_RISE;
+			e->rises++;
+		} else if ((e->state == ANALOG_RISE) && (x <= e->low)) {
+			edge = ANALOG_FALL;
+			e->falls++;
+		}
+		if (edge == 0)
+			continue;
+
+		e->state = edge;
+		if (e->flag)
+			*e->flag = edge;
+		if (e->func)
+			(*e->func)(i, edge);
+	}
+}
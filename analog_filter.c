@@ -0,0 +1,181 @@
+/**
+ * \file analog_filter.c
+ * \brief Per-channel A/D filters
+ *
+ * Filters run by analog_service() on each new sample of a channel, so
+ * tasks read smoothed values instead of each keeping its own average.
+ * Everything is integer arithmetic and filtered values stay on the same
+ * 0-255 scale as the raw samples.
+ *
+ * ANALOG_AVERAGE n: average of n samples, updated once every n samples
+ * (decimating), n = 1 to 64.
+ *
+ * ANALOG_IIR k: single pole low pass, y += (x - y) / 2^k, k = 1 to 8,
+ * kept with 8 fraction bits. The time constant is about 2^k samples.
+ *
+ * ANALOG_MEDIAN n: median of the last n samples, n odd, 3 to 9. Removes
+ * single sample spikes.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "analog.h"
+
+#define ANALOG_AVERAGE_MAX 64
+#define ANALOG_IIR_MAX 8
+#define ANALOG_MEDIAN_MAX 9
+
+/**
+ * Filter state of one channel
+ */
+struct analog_filter
+{
+	volatile int type;            /* ANALOG_RAW etc., set last */
+	int n;                        /* samples or shift */
+	int count;                    /* samples so far */
+	int pos;                      /* median history index */
+	long acc;                     /* sum or IIR state */
+	int out;                      /* last output */
+	unsigned char hist[ANALOG_MEDIAN_MAX];
+};
+
+/**
+ * Filter of each channel
+ */
+struct analog_filter analog_filters[ANALOG_CHANNELS];
+
+
+/**
+ * Set the filter of an A/D channel. The filter starts again from the
+ * next sample.
+ *
+ * @param ch Channel, 0 to 7
+ * @param type ANALOG_RAW, ANALOG_AVERAGE, ANALOG_IIR or ANALOG_MEDIAN
+ * @param n Filter length or shift, see above. Ignored for ANALOG_RAW.
+ * @return 0 if ok, -1 if a parameter is out of range
+ */
+int analog_filter(int ch, int type, int n)
+{
+	struct analog_filter *f;
+
+	if ((ch < 0) || (ch >= ANALOG_CHANNELS))
+		return -1;
+
+	switch (type) {
+	case ANALOG_RAW:
+		break;
+	case ANALOG_AVERAGE:
+		if ((n < 1) || (n > ANALOG_AVERAGE_MAX)) return -1;
+		break;
+	case ANALOG_IIR:
+		if ((n < 1) || (n > ANALOG_IIR_MAX)) return -1;
+		break;
+	case ANALOG_MEDIAN:
+		if ((n < 3) || (n > ANALOG_MEDIAN_MAX) || !(n & 1)) return -1;
+		break;
+	default:
+		return -1;
+	}
+
+	f = &analog_filters[ch];
+	f->type = ANALOG_RAW;         /* service passes samples through */
+	f->n = n;
+	f->count = 0;
+	f->pos = 0;
+	f->acc = 0;
+	f->out = -1;                  /* no output yet */
+	f->type = type;
+
+	return 0;
+}
+
+
+/**
+ * Median of the n samples in hist, by insertion sort of a copy
+ */
+static int analog_median(unsigned char *hist, int n)
+{
+	unsigned char s[ANALOG_MEDIAN_MAX];
+	int i, j, x;
+
+	for (i = 0; i < n; i++) {
+		x = hist[i];
+		for (j = i; (j > 0) && (s[j - 1] > x); j--)
+			s[j] = s[j - 1];
+		s[j] = x;
+	}
+
+	return s[n >> 1];
+}
+
+
+/**
+ * Run the filter of a channel on a new sample. Called by
+ * analog_service().
+ *
+ * @param ch Channel, 0 to 7
+ * @param x New raw sample, 0 to 255
+ * @return Filtered value
+ */
+int analog_filter_run(int ch, int x)
+{
+	struct analog_filter *f;
+	int i;
+
+	f = &analog_filters[ch];
+
+	switch (f->type) {
+
+	case ANALOG_AVERAGE:
+		if (f->count == 0)
+			f->acc = 0;
+		f->acc += x;
+		if (++f->count >= f->n) {
+			f->out = (f->acc + (f->n >> 1)) / f->n;
+			f->count = 0;
+		} else if (f->out < 0)
+			f->out = x;             /* nothing averaged yet */
+		return f->out;
+
+	case ANALOG_IIR:
+		if (f->count == 0) {
+			f->acc = (long)x << 8;  /* start at the first sample */
+			f->count = 1;
+		} else
+			f->acc += (((long)x << 8) - f->acc) >> f->n;
+		return f->out = (f->acc + 0x80) >> 8;
+
+	case ANALOG_MEDIAN:
+		if (f->count == 0) {
+			for (i = 0; i < f->n; i++)
+				f->hist[i] = x;     /* start with a full window */
+			f->count = 1;
+		}
+		f->hist[f->pos] = x;
+		if (++f->pos >= f->n)
+			f->pos = 0;
+		return f->out = analog_median(f->hist, f->n);
+
+	default:
+		return f->out = x;
+	}
+}
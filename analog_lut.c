@@ -0,0 +1,112 @@
+/**
+ * \file analog_lut.c
+ * \brief A/D linearisation tables
+ *
+ * Converts A/D readings to engineering units (mm, mV, ...) by table
+ * lookup in analog_service(), after the channel filter. A table has one
+ * entry for each of the 256 possible readings, so the conversion is a
+ * single indexed load in the interrupt whatever the sensor curve.
+ *
+ * A table can be generated on the host from a measurement CSV with
+ * tools/lutgen and compiled in, or built at run time from a few
+ * calibration points with analog_lut_build(), which interpolates
+ * linearly between them.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "analog.h"
+
+/**
+ * Table of each channel, 0 = values are not converted
+ */
+const short *volatile analog_luts[ANALOG_CHANNELS];
+
+
+/**
+ * Set or remove the conversion table of a channel. an0 thru an7, the
+ * frame and threshold events then use the converted values.
+ *
+ * @param ch Channel, 0 to 7
+ * @param lut ANALOG_LUT_SIZE entries indexed by the reading, or 0 for
+ * none. It is used in place, not copied.
+ * @return 0 if ok, -1 if ch is out of range
+ */
+int analog_set_lut(int ch, const short *lut)
+{
+	if ((ch < 0) || (ch >= ANALOG_CHANNELS))
+		return -1;
+
+	analog_luts[ch] = lut;
+	return 0;
+}
+
+
+/**
+ * Rounded a / b for b > 0
+ */
+static long analog_div(long a, long b)
+{
+	if (a < 0)
+		return -((-a + b / 2) / b);
+	return (a + b / 2) / b;
+}
+
+
+/**
+ * Build a conversion table from calibration points, interpolating
+ * linearly between them. Readings below the first point or above the
+ * last take the value of that point.
+ *
+ * @param p Points in increasing order of raw reading
+ * @param n Number of points, at least 1
+ * @param lut Table to fill, ANALOG_LUT_SIZE entries
+ * @return 0 if ok, -1 if there are no points or they are out of order
+ * or range
+ */
+int analog_lut_build(const struct analog_point *p, int n, short *lut)
+{
+	int x, i;
+
+	if (n < 1)
+		return -1;
+	for (i = 0; i < n; i++) {
+		if ((p[i].raw < 0) || (p[i].raw >= ANALOG_LUT_SIZE))
+			return -1;
+		if ((i > 0) && (p[i].raw <= p[i - 1].raw))
+			return -1;
+	}
+
+	i = 0;
+	for (x = 0; x < ANALOG_LUT_SIZE; x++) {
+		while ((i < n - 1) && (x > p[i + 1].raw))
+			i++;
+		if ((x <= p[0].raw) || (i == n - 1))
+			lut[x] = (x <= p[0].raw) ? p[0].value : p[n - 1].value;
+		else
+			lut[x] = p[i].value + analog_div(
+				(long)(p[i + 1].value - p[i].value) * (x - p[i].raw),
+				p[i + 1].raw - p[i].raw);
+	}
+
+	return 0;
+}
@@ -0,0 +1,267 @@
+/**
+ * \file analog_scope.c
+ * \brief Triggered high rate A/D capture
+ *
+ * Scope mode records chosen A/D channels every 1 ms tick into a ring in
+ * RAM supplied by the application, independent of the normal channel
+ * rates and filters, which keep running. Capture keeps the pre-trigger
+ * samples before the trigger and stops after the post-trigger samples.
+ *
+ *   static unsigned char buf[2000];
+ *
+ *   analog_scope_setup(0x05, buf, sizeof(buf), 200, 800);
+ *   analog_scope_trigger(2, SCOPE_RISING, 128);
+ *   analog_scope_arm();
+ *   while (analog_scope_state() != SCOPE_DONE) defer();
+ *   analog_scope_dump();
+ *
+ * Samples are raw 8 bit values, one byte per channel per tick. The dump
+ * is sent as TLM_TYPE_SCOPE telemetry frames, each holding the channel
+ * mask, the big-endian 16 bit index of its first sample relative to the
+ * trigger sample (which is 0) and as many whole samples as fit, channels
+ * in ascending order. tools/tlm_decode prints them.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "analog.h"
+#include "telemetry.h"
+
+/**
+ * Channels analog_service() must read every tick for the scope, 0 when
+ * not capturing
+ */
+volatile int analog_scope_mask;
+
+unsigned char *scope_buf;          /* sample ring */
+int scope_chans;                   /* recorded channels, bit n */
+int scope_nch;                     /* bytes per sample */
+int scope_size;                    /* ring size in samples */
+int scope_pre, scope_post;         /* depth before and after trigger */
+int scope_pos;                     /* next sample in the ring */
+long scope_count;                  /* samples since armed */
+int scope_left;                    /* post-trigger samples still to take */
+int scope_trig;                    /* ring index of the trigger sample */
+int scope_ch, scope_mode, scope_level;
+int scope_prev;                    /* previous trigger channel sample */
+volatile int scope_state;
+
+
+/**
+ * Set up a capture. Stops any capture in progress.
+ *
+ * @param mask Channels to record, bit n = channel n
+ * @param buf Ring buffer
+ * @param size Size of buf in bytes
+ * @param pre Samples (ms) to keep before the trigger
+ * @param post Samples to keep from the trigger on, at least 1
+ * @return Number of samples the ring holds, or -1 if the capture does
+ * not fit or a parameter is bad
+ */
+int analog_scope_setup(int mask, unsigned char *buf, int size, int pre,
+	int post)
+{
+	int i, n;
+
+	analog_scope_stop();
+	scope_state = SCOPE_IDLE;          /* old capture is gone */
+
+	mask &= 0xff;
+	for (i = n = 0; i < ANALOG_CHANNELS; i++)
+		if (mask & (1 << i))
+			n++;
+
+	if ((n == 0) || (pre < 0) || (post < 1) || (pre + post > size / n))
+		return -1;
+
+	scope_buf = buf;
+	scope_chans = mask;
+	scope_nch = n;
+	scope_size = size / n;
+	scope_pre = pre;
+	scope_post = post;
+	scope_ch = -1;
+	scope_mode = SCOPE_NOW;
+
+	return scope_size;
+}
+
+
+/**
+ * Set the trigger.
+ *
+ * @param ch Channel to watch, 0 to 7; need not be recorded
+ * @param mode SCOPE_NOW, SCOPE_ABOVE, SCOPE_BELOW, SCOPE_RISING or
+ * SCOPE_FALLING
+ * @param level Trigger level, raw 0 to 255. An edge triggers on the
+ * first sample at or above (rising) or below (falling) the level after
+ * one on the other side.
+ * @return 0 if ok, -1 if a parameter is bad
+ */
+int analog_scope_trigger(int ch, int mode, int level)
+{
+	if ((mode < SCOPE_NOW) || (mode > SCOPE_FALLING))
+		return -1;
+	if ((mode != SCOPE_NOW) && ((ch < 0) || (ch >= ANALOG_CHANNELS)))
+		return -1;
+
+	scope_ch = (mode == SCOPE_NOW) ? -1 : ch;
+	scope_mode = mode;
+	scope_level = level;
+	return 0;
+}
+
+
+/**
+ * Start a capture with the current setup and trigger. The trigger is
+ * only accepted once the pre-trigger samples have been taken.
+ *
+ * @return 0 if ok, -1 if not set up
+ */
+int analog_scope_arm()
+{
+	analog_scope_stop();
+
+	if (scope_buf == 0)
+		return -1;
+
+	scope_pos = 0;
+	scope_count = 0;
+	scope_prev = -1;
+	scope_state = SCOPE_ARMED;
+	analog_scope_mask = scope_chans | ((scope_ch >= 0) ? (1 << scope_ch) : 0);
+	return 0;
+}
+
+
+/**
+ * Stop a capture. A finished capture can still be dumped.
+ */
+void analog_scope_stop()
+{
+	analog_scope_mask = 0;
+	if (scope_state != SCOPE_DONE)
+		scope_state = SCOPE_IDLE;
+}
+
+
+/**
+ * @return SCOPE_IDLE, SCOPE_ARMED, SCOPE_TRIGGERED or SCOPE_DONE
+ */
+int analog_scope_state()
+{
+	return scope_state;
+}
+
+
+/**
+ * Test the trigger on a new sample of the trigger channel
+ */
+static int scope_triggered(int x)
+{
+	switch (scope_mode) {
+	case SCOPE_ABOVE:
+		return x >= scope_level;
+	case SCOPE_BELOW:
+		return x < scope_level;
+	case SCOPE_RISING:
+		return (scope_prev >= 0) && (scope_prev < scope_level) &&
+			(x >= scope_level);
+	case SCOPE_FALLING:
+		return (scope_prev >= scope_level) && (x < scope_level);
+	default:
+		return 1;
+	}
+}
+
+
+/**
+ * Record one sample. Called by analog_service() every tick while
+ * analog_scope_mask is set, with the raw values of the channels in it.
+ */
+void analog_scope_sample(int *raw)
+{
+	unsigned char *p;
+	int i;
+
+	p = scope_buf + scope_pos * scope_nch;
+	for (i = 0; i < ANALOG_CHANNELS; i++)
+		if (scope_chans & (1 << i))
+			*p++ = raw[i];
+
+	if ((scope_state == SCOPE_ARMED) && (scope_count >= scope_pre) &&
+	    scope_triggered((scope_ch >= 0) ? raw[scope_ch] : 0)) {
+		scope_state = SCOPE_TRIGGERED;
+		scope_trig = scope_pos;
+		scope_left = scope_post;
+	}
+
+	if (scope_ch >= 0)
+		scope_prev = raw[scope_ch];
+	if (++scope_pos >= scope_size)
+		scope_pos = 0;
+	scope_count++;
+
+	if ((scope_state == SCOPE_TRIGGERED) && (--scope_left <= 0)) {
+		analog_scope_mask = 0;
+		scope_state = SCOPE_DONE;
+	}
+}
+
+
+/**
+ * Send a finished capture as TLM_TYPE_SCOPE telemetry frames. Blocks in
+ * tlm_send() while the SCI drains.
+ *
+ * @return Number of samples sent, or -1 if no capture is done
+ */
+int analog_scope_dump()
+{
+	unsigned char frame[TLM_MAX_PAYLOAD];
+	int per, idx, pos, n, i;
+
+	if (scope_state != SCOPE_DONE)
+		return -1;
+
+	per = (TLM_MAX_PAYLOAD - 3) / scope_nch;
+	pos = scope_trig - scope_pre;
+	if (pos < 0)
+		pos += scope_size;
+	pos *= scope_nch;                  /* byte index in the ring */
+
+	for (idx = -scope_pre; idx < scope_post; idx += n) {
+		frame[0] = scope_chans;
+		frame[1] = (idx >> 8) & 0xff;
+		frame[2] = idx & 0xff;
+		n = scope_post - idx;
+		if (n > per)
+			n = per;
+		for (i = 0; i < n * scope_nch; i++) {
+			frame[3 + i] = scope_buf[pos++];
+			if (pos >= scope_size * scope_nch)
+				pos = 0;
+		}
+		tlm_send(TLM_TYPE_SCOPE, frame, 3 + n * scope_nch);
+	}
+
+	return scope_pre + scope_post;
+}
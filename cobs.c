@@ -0,0 +1,106 @@
+/**
+ * \file cobs.c
+ * \brief Consistent Overhead Byte Stuffing
+ *
+ * COBS encoding removes every zero byte from a block at a cost of at
+ * most one extra byte per 254, so a zero can be used to mark the end of
+ * each frame on a serial link. A receiver that loses sync just waits
+ * for the next zero.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "telemetry.h"
+
+
+/**
+ * COBS encode a block of bytes. The output contains no zero bytes and
+ * does not include the frame delimiter.
+ *
+ * @param src Pointer to the bytes to encode
+ * @param nbytes Number of bytes in src
+ * @param dst Pointer to the output buffer, which must hold at least
+ * COBS_MAX_ENCODED(nbytes) bytes
+ * @return Number of bytes written to dst
+ */
+int cobs_encode(unsigned char *src, int nbytes, unsigned char *dst)
+{
+	unsigned char *code, *out;
+	unsigned char run;
+
+	code = dst;		/* where the current run length goes */
+	out = dst + 1;
+	run = 1;
+
+	while (nbytes-- > 0) {
+		if (*src == 0) {
+			*code = run;
+			code = out++;
+			run = 1;
+		} else {
+			*out++ = *src;
+			if (++run == 0xff) {
+				*code = run;
+				code = out++;
+				run = 1;
+			}
+		}
+		src++;
+	}
+	*code = run;
+
+	return (out - dst);
+}
+
+
+/**
+ * Decode a COBS encoded block. The frame delimiter must already have
+ * been stripped. Decoding may be done in place (dst == src).
+ *
+ * @param src Pointer to the encoded bytes
+ * @param nbytes Number of bytes in src
+ * @param dst Pointer to the output buffer, which must hold nbytes bytes
+ * @return Number of decoded bytes or -1 if the block is malformed
+ */
+int cobs_decode(unsigned char *src, int nbytes, unsigned char *dst)
+{
+	unsigned char *end, *out;
+	int run, i;
+
+	end = src + nbytes;
+	out = dst;
+
+	while (src < end) {
+		run = *src++;
+		if ((run == 0) || (src + run - 1 > end))
+			return -1;
+		for (i = 1; i < run; i++) {
+			if (*src == 0)
+				return -1;
+			*out++ = *src++;
+		}
+		if ((run < 0xff) && (src < end))
+			*out++ = 0;
+	}
+
+	return (out - dst);
+}
@@ -10,6 +10,9 @@
  *
  * 01 Oct 2004 dpa - Created
  *
+ * 18 Oct 2026 agt - Added cpu_clock so drivers can derive their timing from
+ *                   the configured system clock.
+ *
  * \todo Rename globals to new naming scheme
  * \todo cpu_init() should accept an initial clock speed value
  *
@@ -46,6 +49,12 @@ long myvector[256];
  */
 int vbraddr = (int)&myvector[0];
 
+/**
+ * System clock frequency in Hz, as set in SIM_SYNCR by cpu_init().
+ * 32768 Hz crystal * 4 * (Y+1) * 2^(2W+X), with W=1, X=1, Y=23.
+ */
+long cpu_clock = 25165824;
+
 /**
  * Sets up the vector base table and hardware vector base register. 
  * Initializes vectors to CPU32BUG defaults. Sets Flash and RAM wait states.
@@ -0,0 +1,367 @@
+/**
+ * \file dprg_printf.c
+ * \brief Compact integer printf for the SCI and LCD
+ *
+ * A small replacement for newlib printf() for the status lines robots
+ * print many times a second. It formats straight into the SCI or LCD
+ * FIFO with no heap, no stdio buffer and no floating point, so it
+ * neither pulls in malloc nor the float formatting code.
+ *
+ * fd follows the write() convention: 1 = stdout = SCI, 2 = stderr = LCD.
+ * Serial output is gathered in a small stack buffer and copied into the
+ * transmit FIFO with sci_write(), which expands newlines to CR/LF. LCD
+ * output goes through lcd_putc(), so \\n and \\t keep their LCD meaning.
+ * Both call defer() while their FIFO is full.
+ *
+ * Conversions: %d %i %u %x %X %o %c %s %% and %q. Flags '-', '0', '+'
+ * and ' ', a field width and a precision are supported, either of which
+ * may be '*'. The 'l' length modifier takes a long argument and 'h' is
+ * accepted and ignored.
+ *
+ * %q prints a fixed-point number: an int scaled by 10^precision, so
+ * dprg_printf(1, "%.2q V", 1234) prints "12.34 V" and "%.3q" of -5
+ * prints "-0.005". The precision may be 0 to 9.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ * 18 Oct 2026 agt - Print no digits for a zero with a zero precision
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "dprg_printf.h"
+
+/**
+ * Size of the stack buffer used to batch serial output
+ */
+#define DP_BUF_SIZE 32
+
+#define DP_LEFT  0x01	/* '-' left justify */
+#define DP_ZERO  0x02	/* '0' pad with zeros */
+#define DP_PLUS  0x04	/* '+' always print sign */
+#define DP_SPACE 0x08	/* ' ' space for positive sign */
+
+/**
+ * Output state for one dprg_vprintf() call
+ */
+struct dp_out
+{
+	int fd;
+	int n;			/* bytes waiting in buf */
+	int count;		/* total characters produced */
+	char buf[DP_BUF_SIZE];
+};
+
+
+/**
+ * Send the batched serial bytes to the SCI transmit FIFO
+ */
+static void dp_flush(struct dp_out *o)
+{
+	int i;
+
+	i = 0;
+	while (i < o->n) {
+		i += sci_write(o->buf + i, o->n - i, 1);
+		if (i < o->n) defer();
+	}
+	o->n = 0;
+}
+
+
+/**
+ * Output one character
+ */
+static void dp_putc(struct dp_out *o, char c)
+{
+	o->count++;
+	if (o->fd == 2) {
+		while (lcd_putc(c)) defer();
+	} else {
+		o->buf[o->n++] = c;
+		if (o->n == DP_BUF_SIZE)
+			dp_flush(o);
+	}
+}
+
+
+/**
+ * Output a character n times
+ */
+static void dp_pad(struct dp_out *o, char c, int n)
+{
+	while (n-- > 0)
+		dp_putc(o, c);
+}
+
+
+/**
+ * Output a string of known length, padded to a field width
+ */
+static void dp_field(struct dp_out *o, const char *s, int len, int width,
+	int flags)
+{
+	int i;
+
+	if (!(flags & DP_LEFT))
+		dp_pad(o, ' ', width - len);
+	for (i = 0; i < len; i++)
+		dp_putc(o, s[i]);
+	if (flags & DP_LEFT)
+		dp_pad(o, ' ', width - len);
+}
+
+
+/**
+ * Output a number.
+ *
+ * @param o Output state
+ * @param v Magnitude of the number
+ * @param neg Non-zero if the number is negative
+ * @param base 8, 10 or 16
+ * @param upper Non-zero for upper case hex digits
+ * @param width Minimum field width
+ * @param prec Minimum number of digits, or for %q the number of digits
+ * after the decimal point, -1 if not given
+ * @param point Non-zero to insert a decimal point prec digits from the
+ * right (%q)
+ * @param flags DP_ flags
+ */
+static void dp_number(struct dp_out *o, unsigned long v, int neg, int base,
+	int upper, int width, int prec, int point, int flags)
+{
+	char tmp[12];
+	const char *digits;
+	char sign;
+	int n, total, len;
+
+	digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+
+	/* a zero with a zero precision has no digits, as in C */
+	n = 0;
+	if (v || point || (prec != 0)) {
+		do {
+			tmp[n++] = digits[v % base];
+			v /= base;
+		} while (v);
+	}
+
+	/* total digits: at least prec, and one before any decimal point */
+	total = n;
+	if (point) {
+		if (total <= prec)
+			total = prec + 1;
+	} else if (prec > total) {
+		total = prec;
+	}
+
+	sign = 0;
+	if (neg)
+		sign = '-';
+	else if (flags & DP_PLUS)
+		sign = '+';
+	else if (flags & DP_SPACE)
+		sign = ' ';
+
+	len = total + (sign != 0) + ((point && (prec > 0)) ? 1 : 0);
+
+	/* the '0' flag is ignored when a precision is given, as in C */
+	if ((flags & DP_ZERO) && !(flags & DP_LEFT) && (point || (prec < 0))) {
+		if (width > len) {
+			total += width - len;
+			len = width;
+		}
+	}
+
+	if (!(flags & DP_LEFT))
+		dp_pad(o, ' ', width - len);
+	if (sign)
+		dp_putc(o, sign);
+
+	while (total-- > 0) {
+		dp_putc(o, (total < n) ? tmp[total] : '0');
+		if (point && (prec > 0) && (total == prec))
+			dp_putc(o, '.');
+	}
+
+	if (flags & DP_LEFT)
+		dp_pad(o, ' ', width - len);
+}
+
+
+/**
+ * Formatted output to the SCI or LCD with a va_list
+ *
+ * @param fd 1 = stdout = SCI or 2 = stderr = LCD
+ * @param fmt Format string, see the file description
+ * @param ap Arguments
+ * @return Number of characters written, not counting CRs added to
+ * serial newlines
+ */
+int dprg_vprintf(int fd, const char *fmt, va_list ap)
+{
+	struct dp_out o;
+	const char *s;
+	unsigned long u;
+	long l;
+	int flags, width, prec, len, lng;
+	char c;
+
+	o.fd = fd;
+	o.n = 0;
+	o.count = 0;
+
+	while ((c = *fmt++) != 0) {
+		if (c != '%') {
+			dp_putc(&o, c);
+			continue;
+		}
+
+		/* flags */
+		flags = 0;
+		while (1) {
+			c = *fmt;
+			if (c == '-') flags |= DP_LEFT;
+			else if (c == '0') flags |= DP_ZERO;
+			else if (c == '+') flags |= DP_PLUS;
+			else if (c == ' ') flags |= DP_SPACE;
+			else break;
+			fmt++;
+		}
+
+		/* width */
+		width = 0;
+		if (*fmt == '*') {
+			width = va_arg(ap, int);
+			if (width < 0) {
+				flags |= DP_LEFT;
+				width = -width;
+			}
+			fmt++;
+		} else {
+			while ((*fmt >= '0') && (*fmt <= '9'))
+				width = width * 10 + (*fmt++ - '0');
+		}
+
+		/* precision */
+		prec = -1;
+		if (*fmt == '.') {
+			fmt++;
+			prec = 0;
+			if (*fmt == '*') {
+				prec = va_arg(ap, int);
+				fmt++;
+			} else {
+				while ((*fmt >= '0') && (*fmt <= '9'))
+					prec = prec * 10 + (*fmt++ - '0');
+			}
+		}
+
+		/* length modifiers */
+		lng = 0;
+		while ((*fmt == 'l') || (*fmt == 'h')) {
+			if (*fmt == 'l') lng = 1;
+			fmt++;
+		}
+
+		c = *fmt++;
+		switch (c) {
+		case 'd':
+		case 'i':
+			l = lng ? va_arg(ap, long) : va_arg(ap, int);
+			u = (l < 0) ? -(unsigned long)l : (unsigned long)l;
+			dp_number(&o, u, l < 0, 10, 0, width, prec, 0, flags);
+			break;
+		case 'q':
+			l = lng ? va_arg(ap, long) : va_arg(ap, int);
+			u = (l < 0) ? -(unsigned long)l : (unsigned long)l;
+			if (prec < 0) prec = 0;
+			if (prec > 9) prec = 9;
+			dp_number(&o, u, l < 0, 10, 0, width, prec, 1, flags);
+			break;
+		case 'u':
+			u = lng ? va_arg(ap, unsigned long) :
+				va_arg(ap, unsigned int);
+			dp_number(&o, u, 0, 10, 0, width, prec, 0,
+				flags & ~(DP_PLUS | DP_SPACE));
+			break;
+		case 'x':
+		case 'X':
+			u = lng ? va_arg(ap, unsigned long) :
+				va_arg(ap, unsigned int);
+			dp_number(&o, u, 0, 16, c == 'X', width, prec, 0,
+				flags & ~(DP_PLUS | DP_SPACE));
+			break;
+		case 'o':
+			u = lng ? va_arg(ap, unsigned long) :
+				va_arg(ap, unsigned int);
+			dp_number(&o, u, 0, 8, 0, width, prec, 0,
+				flags & ~(DP_PLUS | DP_SPACE));
+			break;
+		case 'c':
+			c = va_arg(ap, int);
+			dp_field(&o, &c, 1, width, flags);
+			break;
+		case 's':
+			s = va_arg(ap, const char *);
+			if (s == 0) s = "(null)";
+			for (len = 0; s[len] && ((prec < 0) || (len < prec)); len++)
+				;
+			dp_field(&o, s, len, width, flags);
+			break;
+		case '%':
+			dp_putc(&o, '%');
+			break;
+		case 0:
+			fmt--;		/* lone '%' at the end */
+			break;
+		default:		/* unknown, print it as is */
+			dp_putc(&o, '%');
+			dp_putc(&o, c);
+			break;
+		}
+	}
+
+	if (o.n)
+		dp_flush(&o);
+
+	return o.count;
+}
+
+
+/**
+ * Formatted output to the SCI or LCD. See the file description for the
+ * supported conversions.
+ *
+ * @param fd 1 = stdout = SCI or 2 = stderr = LCD
+ * @param fmt Format string
+ * @return Number of characters written
+ */
+int dprg_printf(int fd, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = dprg_vprintf(fd, fmt, ap);
+	va_end(ap);
+
+	return n;
+}
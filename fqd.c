@@ -6,6 +6,12 @@
  *
  * Uses the queue structure and functions from "queue.h"
  *
+ * The encoders read by speedometer() are listed in fqd_encoders, each
+ * by the base channel of its TPU channel pair. Entries 0 and 1 are the
+ * left and right drive wheels, channels 2 and 4 by default, and are
+ * also published as left_position etc. for existing code. Further
+ * wheels or manipulator joints are added with fqd_add_encoder().
+ *
  * <b>History:</b>
  *
  * 04 Oct 2004 dpa - Created based on DLG's RTEMS bot code
@@ -18,6 +24,18 @@
  *
  * 30 Dec 2006 rsr - Normalized indentation
  *
+ * 18 Oct 2026 agt - speedometer() works through a table of encoders instead
+ *                   of fixed left and right channels.
+ *
+ * 18 Oct 2026 agt - 32 bit positions from counter changes, without zeroing
+ *                   the counters. Sample rate and velocity window are set
+ *                   with fqd_set_rate().
+ *
+ * 18 Oct 2026 agt - Added speedometer_hook, used by odometry.c.
+ *
+ * 18 Oct 2026 agt - Added the fine velocity from FQD edge times for low
+ *                   speeds.
+ *
  * \todo Verify license status of DLG's code
  *
  */
@@ -41,6 +59,7 @@
 */
 
 #include "tpu.h"
+#include "fqd.h"
 
 /* int g->fqd_enable; */
 
@@ -130,49 +149,367 @@ void fqd_write(int chan, unsigned value)
 	*(unsigned short *) (TPU_RAM + (chan * 16 + 0x2)) = value;
 }
 
+/* fast decode above this many counts per 50 ms */
 #define VELOCITY 2000
 
+/**
+ * Encoders read by speedometer(), see fqd_add_encoder()
+ */
+struct fqd_encoder fqd_encoders[FQD_MAX] = {
+	{ 2 },	/* left */
+	{ 4 }	/* right */
+};
+
+/**
+ * Number of entries in fqd_encoders
+ */
+volatile int fqd_count = 2;
+
 /**
  * Global velocity values
  */
 int left_velocity, right_velocity;
 
+/**
+ * Fine velocity of the left and right encoders, counts per velocity
+ * window with 8 fraction bits. Uses the edge times only while the sample
+ * period is at most 4 ms, e.g. after fqd_set_rate(1, 50); otherwise it
+ * is the velocity times 256.
+ */
+int left_fine, right_fine;
+
 /**
  * Global position counters
  */
 int left_position, right_position;
 
+#define SPD_WAIT 50
+
 /**
- * Calculates the current velocity and position of the left and right
- * encoders. This should be run at 25hz.
+ * Milliseconds between speedometer_handler() samples
  */
-void speedometer(void)
+int spd_period = SPD_WAIT;
+
+/**
+ * Samples per velocity window, and samples so far in this one
+ */
+int spd_vsamples = 1, spd_vcount;
+
+/**
+ * Velocity window in ms, for scaling the fast decode threshold
+ */
+int spd_vwindow = SPD_WAIT;
+
+/**
+ * If set, called by speedometer() after each sample with the left and
+ * right encoder counts of the sample, e.g. odometry_update()
+ */
+void (*volatile speedometer_hook)(int left, int right);
+
+
+/**
+ * Set the TPU channel pair of encoder n. Use it to move the left (0) or
+ * right (1) encoder off the default channels. The TPU channels must
+ * still be set up with fqd_init().
+ *
+ * @param n Encoder number, 0 to FQD_MAX-1. n may be fqd_count, which
+ * appends an encoder, but no further, so every entry speedometer() reads
+ * has been set.
+ * @param chan Base TPU channel of the pair
+ * @return 0 if ok, -1 if out of range
+ */
+int fqd_set_encoder(int n, int chan)
+{
+	struct fqd_encoder *e;
+
+	if ((n < 0) || (n > fqd_count) || (n >= FQD_MAX) ||
+	    (chan < 0) || (chan > 14))
+		return -1;
+
+	e = &fqd_encoders[n];
+	e->started = 0;             /* hold off speedometer() */
+	e->chan = chan;
+	e->position = 0;
+	e->velocity = 0;
+	e->vstart = 0;
+	e->started = 0;             /* in case it ran meanwhile */
+	if (n == fqd_count)
+		fqd_count = n + 1;
+
+	return 0;
+}
+
+
+/**
+ * Add an encoder to the end of the table read by speedometer().
+ *
+ * @param chan Base TPU channel of the pair, set up with fqd_init()
+ * @return Encoder number, or -1 if the table is full
+ */
+int fqd_add_encoder(int chan)
+{
+	int n;
+
+	n = fqd_count;
+	if (fqd_set_encoder(n, chan))
+		return -1;
+	return n;
+}
+
+
+/**
+ * Set how often speedometer_handler() samples the encoders and over what
+ * time velocity is measured. Positions are updated at each sample;
+ * velocity is the change of position over the window, updated at the
+ * end of each window. The default, 50 and 50, is the original 20 Hz
+ * speedometer with velocity in counts per 50 ms. A sample period of 4 ms
+ * or less also turns on the fine velocity, see left_fine.
+ *
+ * @param sample_ms Sample period, 1 (1 kHz) or more
+ * @param velocity_ms Velocity window, rounded to whole samples
+ * @return 0 if ok, -1 if out of range
+ */
+int fqd_set_rate(int sample_ms, int velocity_ms)
 {
-	// temp - fix this!!
-	int t1 = 2;
-	int t2 = 4;
+	int n;
 
-	left_velocity  = fqd_position(t1,1);
-	right_velocity = fqd_position(t2,1);
+	if ((sample_ms < 1) || (velocity_ms < sample_ms))
+		return -1;
 
-	left_position += left_velocity;
-	right_position += right_velocity;
+	n = (velocity_ms + sample_ms / 2) / sample_ms;
+	spd_vcount = 0;
+	spd_vsamples = n;
+	spd_vwindow = n * sample_ms;
+	spd_period = sample_ms;
 
-	if ((left_velocity > VELOCITY) || (left_velocity < -VELOCITY)) {
-		tpu_set_hsqr(t1, 0x2);	/* fast decode */
+	/* edges timed at the old rate are stale, start again */
+	for (n = 0; n < fqd_count; n++)
+		fqd_encoders[n].edges = 0;
+	return 0;
+}
+
+
+/* edge times are used if the sample period is at most this many ms */
+#define FQD_EDGE_PERIOD 4
+
+/* counts per window at or below which only edge times are used, and
+   at or above which only counts are used; in between the two blend */
+#define FQD_MT_LOW 8
+#define FQD_MT_HIGH 16
+
+/* fine velocity is 0 after this many ms without an edge */
+#define FQD_STOP_MS 500
+
+/**
+ * Whole TCR1 ticks in ms milliseconds
+ */
+static unsigned long fqd_tcr1(long ms)
+{
+	return ms * (TCR1_CLOCK / 1000) + (ms * (TCR1_CLOCK % 1000)) / 1000;
+}
+
+
+/**
+ * Velocity in counts per window, 8 fraction bits, of m counts (|m| at
+ * most 31) in t TCR1 ticks
+ */
+static int fqd_rate(int m, unsigned long t)
+{
+	unsigned long w, v;
+	int neg;
+
+	w = fqd_tcr1(spd_vwindow);
+	while (w >= 0x40000) {                 /* keep the product in 32 bits */
+		w >>= 1;
+		t >>= 1;
+	}
+	if (t == 0)
+		t = 1;
+
+	neg = (m < 0);
+	if (neg)
+		m = -m;
+	v = ((unsigned long)m << 8) * w / t;
+	if (v > 0x7fffffffUL / 2)
+		v = 0x7fffffffUL / 2;
+
+	return neg ? -(long)v : (long)v;
+}
+
+
+/**
+ * Record an edge seen by this sample. The FQD edge time is the 16 bit
+ * TCR1 time of the latest edge; TCR1 wraps about every 10 ms, so whole
+ * wraps since the previous edge are counted from sysclock, which is
+ * exact while the sample period is at most FQD_EDGE_PERIOD. After more
+ * than FQD_STOP_MS without an edge the time is not extended across the
+ * gap; the edge starts again as the first one.
+ */
+static void fqd_edge(struct fqd_encoder *e, unsigned short t)
+{
+	extern long sysclock;
+	unsigned long dt, est;
+
+	if (e->edges && (sysclock - e->edge_clock > FQD_STOP_MS))
+		e->edges = 0;                      /* stopped, start again */
+
+	if (e->edges) {
+		dt = (unsigned short)(t - e->edge16);
+		est = fqd_tcr1(sysclock - e->edge_clock);
+		if (est > dt)
+			dt += ((est - dt + 0x8000) >> 16) << 16;
+		e->edge32 += dt;
 	} else {
-		tpu_set_hsqr(t1, 0x0);	/* normal decode */
+		e->ref_edge32 = e->edge32;         /* first edge */
+		e->ref_pos = e->position;
 	}
 
-	if ((right_velocity > VELOCITY) || (right_velocity < -VELOCITY)) {
-		tpu_set_hsqr(t2, 0x2);	/* fast decode */
+	e->edge16 = t;
+	e->edge_pos = e->position;
+	e->edge_clock = sysclock;
+	e->edges = 1;
+}
+
+
+/**
+ * Fine velocity at the end of a window. At low speed it is the counts
+ * between the last edge of the previous window and the last edge of
+ * this one over the time between them; with no edge it falls as the
+ * time since the last edge grows. At higher speed it is the count over
+ * the window.
+ */
+static int fqd_fine(struct fqd_encoder *e)
+{
+	extern long sysclock;
+	long m, since;
+	int n, mt, bound;
+
+	n = (e->velocity < 0) ? -e->velocity : e->velocity;
+
+	if ((spd_period > FQD_EDGE_PERIOD) || !e->edges) {
+		mt = e->velocity << 8;
+	} else if (e->edge32 != e->ref_edge32) {
+		m = e->edge_pos - e->ref_pos;
+		mt = ((m >= -31) && (m <= 31)) ?
+			fqd_rate(m, e->edge32 - e->ref_edge32) : e->velocity << 8;
 	} else {
-		tpu_set_hsqr(t2, 0x0);	/* normal decode */
+		mt = e->fine;                      /* no edge this window */
+		since = sysclock - e->edge_clock;
+		if (since > FQD_STOP_MS) {
+			mt = 0;
+		} else {
+			bound = fqd_rate(1, fqd_tcr1(since));
+			if (mt > bound)
+				mt = bound;
+			if (mt < -bound)
+				mt = -bound;
+		}
 	}
+
+	e->ref_edge32 = e->edge32;
+	e->ref_pos = e->edge_pos;
+
+	if (n <= FQD_MT_LOW)
+		return mt;
+	if (n >= FQD_MT_HIGH)
+		return e->velocity << 8;
+	return ((long)mt * (FQD_MT_HIGH - n) +
+		((long)e->velocity << 8) * (n - FQD_MT_LOW)) /
+		(FQD_MT_HIGH - FQD_MT_LOW);
 }
 
 
-#define SPD_WAIT 50
+/**
+ * Updates the position of each encoder in the table, and of the left and
+ * right encoders, from the change of the TPU counter since the last
+ * sample, and the velocity at the end of each velocity window. The 16 bit
+ * counters are never zeroed, so no counts are lost, and positions are 32
+ * bits. The counters must not be zeroed elsewhere, e.g. with
+ * fqd_position(chan, 1).
+ *
+ * The fine velocity (left_fine, right_fine and the fine field of each
+ * encoder), in counts per window with 8 fraction bits, also uses the
+ * FQD edge times when the sample period is at most 4 ms. Below 8 counts
+ * per window it is the counts between edges over the time between them,
+ * which resolves fractions of a count per window, and above 16 it is the
+ * plain count; in between the two are blended.
+ *
+ * Run from speedometer_handler() or called directly; when called
+ * directly each call is one sample.
+ */
+void speedometer(void)
+{
+	struct fqd_encoder *e;
+	volatile unsigned short *ram;
+	void (*hook)(int left, int right);
+	unsigned short count, t;
+	int delta[2];
+	int n, window;
+
+	window = (++spd_vcount >= spd_vsamples);
+	if (window)
+		spd_vcount = 0;
+
+	delta[0] = delta[1] = 0;
+
+	for (n = 0; n < fqd_count; n++) {
+		e = &fqd_encoders[n];
+
+		/* position count and the time of its last edge */
+		ram = (volatile unsigned short *)(TPU_RAM + e->chan * 16);
+		do {
+			count = ram[1];
+			t = ram[0];
+		} while (count != ram[1]);
+
+		if (!e->started) {
+			e->last = count;            /* first sample, no change */
+			e->vstart = e->position;
+			e->edges = 0;
+			e->fine = 0;
+			e->started = 1;
+			continue;
+		}
+
+		e->delta = (short)(count - e->last);
+		e->last = count;
+		e->position += e->delta;
+		if (n < 2)
+			delta[n] = e->delta;
+
+		if (e->delta && (spd_period <= FQD_EDGE_PERIOD))
+			fqd_edge(e, t);
+
+		if (!window)
+			continue;
+
+		e->velocity = e->position - e->vstart;
+		e->vstart = e->position;
+		e->fine = fqd_fine(e);
+
+		if ((e->velocity > VELOCITY * spd_vwindow / SPD_WAIT) ||
+		    (e->velocity < -VELOCITY * spd_vwindow / SPD_WAIT)) {
+			tpu_set_hsqr(e->chan, 0x2);	/* fast decode */
+		} else {
+			tpu_set_hsqr(e->chan, 0x0);	/* normal decode */
+		}
+	}
+
+	/* applications may reset these, so accumulate them separately */
+	left_position += delta[0];
+	right_position += delta[1];
+	if (window) {
+		left_velocity  = fqd_encoders[0].velocity;
+		right_velocity = fqd_encoders[1].velocity;
+		left_fine  = fqd_encoders[0].fine;
+		right_fine = fqd_encoders[1].fine;
+	}
+
+	hook = speedometer_hook;
+	if (hook)
+		(*hook)(delta[0], delta[1]);
+}
+
 
 /**
  * Global speedometer handler wait counter
@@ -181,13 +518,14 @@ int spd_wait;
 
 /**
  * This handler should be run from the 1Khz system interrupt. It
- * will execute the speedometer function at 25hz (modulo 50).
+ * will execute the speedometer function every spd_period ms, 20 Hz
+ * by default (modulo 50). See fqd_set_rate().
  */
 void speedometer_handler(void)
 {
-	if (spd_wait == 0) {
+	if (spd_wait <= 0) {
 		speedometer();
-		spd_wait = SPD_WAIT;
+		spd_wait = spd_period;
 	}
 	spd_wait--;
 }
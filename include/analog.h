@@ -1,4 +1,76 @@
 /* analog.h */
 
-extern int an0,an1,an2,an3,an4,an5,an6,an7;
+extern volatile int an0,an1,an2,an3,an4,an5,an6,an7;
 
+#define ANALOG_CHANNELS 8
+
+/* one A/D scan of all channels */
+struct analog_frame
+{
+	long time;                    /* sysclock at the scan */
+	unsigned long seq;            /* scan number */
+	int fresh;                    /* channels read in this scan, bit n */
+	int value[ANALOG_CHANNELS];   /* an0 .. an7 */
+};
+
+extern volatile struct analog_frame analog_frame;
+
+void analog_service();
+unsigned long analog_read_frame(struct analog_frame *f);
+int analog_set_rate(int ch, int ms);
+void analog_set_mask(int mask);
+
+/* filter types for analog_filter() */
+#define ANALOG_RAW	0	/* no filter */
+#define ANALOG_AVERAGE	1	/* decimating average of n samples */
+#define ANALOG_IIR	2	/* single pole low pass, y += (x - y) >> n */
+#define ANALOG_MEDIAN	3	/* median of the last n samples */
+
+int analog_filter(int ch, int type, int n);
+int analog_filter_run(int ch, int x);
+
+/* scope capture states and trigger modes, see analog_scope.c */
+#define SCOPE_IDLE	0
+#define SCOPE_ARMED	1	/* recording, waiting for the trigger */
+#define SCOPE_TRIGGERED	2	/* recording post-trigger samples */
+#define SCOPE_DONE	3
+
+#define SCOPE_NOW	0	/* trigger at once */
+#define SCOPE_ABOVE	1	/* level, sample >= level */
+#define SCOPE_BELOW	2	/* level, sample < level */
+#define SCOPE_RISING	3	/* edge, crossing up through level */
+#define SCOPE_FALLING	4	/* edge, crossing down through level */
+
+int analog_scope_setup(int mask, unsigned char *buf, int size, int pre,
+	int post);
+int analog_scope_trigger(int ch, int mode, int level);
+int analog_scope_arm();
+void analog_scope_stop();
+int analog_scope_state();
+void analog_scope_sample(int *raw);
+int analog_scope_dump();
+
+/* threshold events, see analog_event.c */
+#define ANALOG_EVENTS	8	/* most events at once */
+#define ANALOG_RISE	1	/* value reached the high threshold */
+#define ANALOG_FALL	2	/* value fell to the low threshold */
+
+int analog_event(int ch, int high, int low, volatile int *flag,
+	void (*func)(int id, int edge));
+void analog_event_remove(int id);
+int analog_event_state(int id);
+int analog_event_wait(int id, int edges, long timeout);
+void analog_event_check(int fresh, volatile int *v);
+
+/* linearisation tables, see analog_lut.c */
+#define ANALOG_LUT_SIZE	256	/* one entry per 8 bit reading */
+
+/* calibration point: reading and value in engineering units */
+struct analog_point
+{
+	int raw;
+	int value;
+};
+
+int analog_set_lut(int ch, const short *lut);
+int analog_lut_build(const struct analog_point *p, int n, short *lut);
@@ -0,0 +1,44 @@
+/* 
+ * crc.h - cyclic redundancy check definitions
+ *
+ * History
+ * 18 October 2026 - agent@local
+ *  - created
+ *  - added CRC-32 and the table size options
+ */
+
+/*
+ * Table options, trading table size against speed. Select one by
+ * defining CRC_TABLE when building crc.c, e.g. -DCRC_TABLE=CRC_SLICE4.
+ *
+ * CRC_NIBBLE  16 entry tables, 96 bytes of flash, two lookups per byte
+ * CRC_BYTE    256 entry tables, 1.5 KB of flash, one lookup per byte
+ * CRC_SLICE4  CRC_BYTE plus 4.5 KB of RAM tables built by crc_init(),
+ *             blocks are processed four bytes per step
+ */
+#define CRC_NIBBLE	1
+#define CRC_BYTE	2
+#define CRC_SLICE4	3
+
+#ifndef CRC_TABLE
+#define CRC_TABLE	CRC_BYTE
+#endif
+
+/* CRC-16/CCITT (polynomial 0x1021, MSB first) initial value */
+#define CRC16_INIT	0xffff
+
+/* CRC-32 (IEEE 802.3, as zlib) initial value, inversion is internal */
+#define CRC32_INIT	0
+
+/* crc_bench() kernels */
+#define CRC_BENCH_16		0	/* crc16_update() on a block */
+#define CRC_BENCH_32		1	/* crc32_update() on a block */
+#define CRC_BENCH_16_BYTE	2	/* crc16_byte() per byte */
+#define CRC_BENCH_32_BYTE	3	/* crc32_byte() per byte */
+
+void crc_init(void);
+long crc_bench(int which, int ms);
+unsigned short crc16_update(unsigned short crc, unsigned char *buf, int nbytes);
+unsigned short crc16_byte(unsigned short crc, unsigned char byte);
+unsigned long crc32_update(unsigned long crc, unsigned char *buf, int nbytes);
+unsigned long crc32_byte(unsigned long crc, unsigned char byte);
@@ -0,0 +1,12 @@
+/* 
+ * dprg_printf.h - compact integer printf for the SCI and LCD
+ *
+ * History
+ * 18 October 2026 - agent@local
+ *  - created
+ */
+
+#include <stdarg.h>
+
+int dprg_printf(int fd, const char *fmt, ...);
+int dprg_vprintf(int fd, const char *fmt, va_list ap);
@@ -0,0 +1,57 @@
+/* 
+ * fqd.h - TPU quadrature decoder and speedometer definitions
+ *
+ * History
+ * 18 October 2026 - agent@local
+ *  - created
+ *  - added left_fine and right_fine
+ *  - exported spd_period and spd_vwindow
+ */
+
+/* most encoders, one per pair of the 16 TPU channels */
+#define FQD_MAX	8
+
+/* one encoder read by speedometer() */
+struct fqd_encoder
+{
+	int chan;                /* base TPU channel of the pair */
+	long position;           /* counts, 32 bits */
+	int velocity;            /* counts per velocity window */
+	int delta;               /* counts in the last sample */
+	unsigned short last;     /* TPU counter at the last sample */
+	int started;             /* last is valid */
+	long vstart;             /* position at the start of the window */
+	int fine;                /* velocity, 8 fraction bits, see left_fine */
+	int edges;               /* an edge has been timed */
+	unsigned short edge16;   /* TCR1 time of the last edge */
+	unsigned long edge32;    /* the same, extended to 32 bits */
+	long edge_pos;           /* position at the last edge */
+	long edge_clock;         /* sysclock when it was seen */
+	unsigned long ref_edge32;  /* last edge before this window */
+	long ref_pos;
+};
+
+extern struct fqd_encoder fqd_encoders[FQD_MAX];
+extern volatile int fqd_count;
+
+extern int left_velocity, right_velocity;
+
+/* velocity in counts per window with 8 fraction bits, using the FQD edge
+   times at low speed; only with a sample period of 4 ms or less, set
+   with e.g. fqd_set_rate(1, 50), otherwise it is velocity * 256. Each
+   fqd_set_rate() call restarts the edge timing. */
+extern int left_fine, right_fine;
+extern int left_position, right_position;
+extern void (*volatile speedometer_hook)(int left, int right);
+
+/* sample period and velocity window in ms, set with fqd_set_rate() */
+extern int spd_period, spd_vwindow;
+
+int fqd_init(int chan, int prio);
+int fqd_position(int chan, int zero);
+void fqd_write(int chan, unsigned value);
+int fqd_set_encoder(int n, int chan);
+int fqd_add_encoder(int chan);
+int fqd_set_rate(int sample_ms, int velocity_ms);
+void speedometer(void);
+void speedometer_handler(void);
@@ -8,4 +8,20 @@ int lcd_write_reg(char val);
 int lcd_write_data(char val);
 int lcd_cursor(int row);
 void lcd_service();
+void lcd_set_burst(int steps, int polls);
+int lcd_put_at(int row, int col, char *str);
+int lcd_set_geometry(int rows, int cols);
+
+/* character code of custom glyph n: 1-7 for glyphs 1-7 and 8 for glyph
+   0, never NUL, tab (9) or newline (10), so usable in FIFO strings */
+#define LCD_GLYPH(n) ((n) ? (n) : 8)
+
+int lcd_define_glyph(int n, const unsigned char *rows);
+
+#define LCD_BAR_H 1              /* horizontal bars, glyphs 0-3 */
+#define LCD_BAR_V 2              /* vertical bars, glyphs 0-6 */
+
+int lcd_bar_mode(int mode);
+int lcd_hbar(int row, int col, int width, int value, int max);
+int lcd_vbar(int row, int col, int height, int value, int max);
 
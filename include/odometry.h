@@ -0,0 +1,37 @@
+/* 
+ * odometry.h - fixed point differential drive odometry definitions
+ *
+ * History
+ * 18 October 2026 - agent@local
+ *  - created
+ *  - added ODO_PERIOD
+ */
+
+/* longest encoder sample period odometry runs with, ms */
+#define ODO_PERIOD	10
+
+/* fraction bits of x, y and distance */
+#define ODO_FRAC	8
+
+/* whole units to pose units, and back (rounding down) */
+#define ODO_UNITS(n)	((long)(n) << ODO_FRAC)
+#define ODO_WHOLE(n)	((n) >> ODO_FRAC)
+
+/* degrees to binary angle */
+#define ODO_DEGREES(d)	((unsigned)(((long)(d) * 65536L) / 360))
+
+struct odometry_pose
+{
+	long x, y;              /* position, ODO_FRAC fraction bits */
+	unsigned heading;       /* binary angle, 65536 = 360 degrees */
+	long distance;          /* path length since set, ODO_FRAC bits */
+};
+
+extern volatile struct odometry_pose odometry_pose;
+
+int odometry_init(long counts, long distance, long wheelbase);
+void odometry_set(long x, long y, unsigned heading);
+void odometry_read(struct odometry_pose *p);
+void odometry_update(int left, int right);
+int odometry_sin(unsigned a);
+int odometry_cos(unsigned a);
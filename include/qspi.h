@@ -0,0 +1,50 @@
+/* 
+ * qspi.h - QSM queued serial peripheral interface driver definitions
+ *
+ * History
+ * 18 October 2026 - agent@local
+ *  - created
+ */
+
+/* the QSM uses the SCI vector for the SCI and that vector + 1 for QSPI */
+#define QSPIVEC		0x57
+
+/* QSPI interrupt priority. system_init() masks levels 5 and below, so
+   this shares level 6 with the SCI and system clock */
+#define QSPI_LEVEL	6
+
+/* depth of the QSPI queue RAM */
+#define QSPI_QUEUE_SIZE	16
+
+/* command RAM bits */
+#define QSPI_CONT	0x80	/* keep chip selects asserted after this word */
+#define QSPI_BITSE	0x40	/* use SPCR0 BITS rather than 8 bits */
+#define QSPI_DT		0x20	/* use SPCR1 DTL delay after transfer */
+#define QSPI_DSCK	0x10	/* use SPCR1 DSCKL delay before SCK */
+
+/* PCS3..PCS0 levels with only chip select n driven low */
+#define QSPI_PCS(n)	(0x0f & ~(1 << (n)))
+
+/* driver states */
+#define QSPI_IDLE	0
+#define QSPI_RUNNING	1	/* one-shot queue running */
+#define QSPI_DONE	2	/* queue finished, results not yet collected */
+#define QSPI_CONTINUOUS	3	/* queue running in wrap-around mode */
+
+/* a device on the QSPI bus, filled in by qspi_device() */
+struct qspi_dev
+{
+	unsigned short spcr0;	/* master, bits per word, mode and baud */
+	unsigned char pcs;	/* chip select levels while selected */
+};
+
+void qspi_init(void);
+long qspi_device(struct qspi_dev *d, long baud, int bits, int mode, int pcs);
+int qspi_start(struct qspi_dev *d, unsigned char *cmd, unsigned short *tx,
+	int n, int wrap);
+int qspi_done(void);
+int qspi_finish(unsigned short *rx, int n);
+int qspi_transfer(struct qspi_dev *d, unsigned short *tx, unsigned short *rx,
+	int n);
+void qspi_read(unsigned short *rx, int n);
+void qspi_stop(void);
@@ -0,0 +1,57 @@
+/* 
+ * telemetry.h - framed binary telemetry link definitions
+ *
+ * A frame is type, sequence number, payload and a big-endian CRC-16 of
+ * everything before it. It is COBS encoded and ends with a zero byte.
+ *
+ * History
+ * 18 October 2026 - agent@local
+ *  - created
+ *  - added watch frame types
+ *  - added scope frame type
+ */
+
+/* largest payload carried by one frame */
+#define TLM_MAX_PAYLOAD	64
+
+/* type + seq + payload + crc, before encoding */
+#define TLM_MAX_FRAME	(TLM_MAX_PAYLOAD + 4)
+
+/* worst case size of a COBS encoded block of n bytes */
+#define COBS_MAX_ENCODED(n)	((n) + ((n) / 254) + 1)
+
+/* largest encoded frame, not counting the zero delimiter */
+#define TLM_MAX_ENCODED	COBS_MAX_ENCODED(TLM_MAX_FRAME)
+
+/* frame delimiter */
+#define TLM_DELIM	0x00
+
+/* payload types, application types start at TLM_TYPE_USER */
+#define TLM_TYPE_TEXT	0x01	/* plain text, not terminated */
+#define TLM_TYPE_BYTES	0x02	/* array of unsigned bytes */
+#define TLM_TYPE_SHORTS	0x03	/* array of big-endian 16 bit words */
+#define TLM_TYPE_LONGS	0x04	/* array of big-endian 32 bit words */
+#define TLM_TYPE_WATCH	0x05	/* watch sample, see watch.c */
+#define TLM_TYPE_WATCH_LIST 0x06 /* watch variable index, type and name */
+#define TLM_TYPE_SCOPE	0x07	/* A/D capture samples, see analog_scope.c */
+#define TLM_TYPE_USER	0x80
+
+struct tlm_frame
+{
+	unsigned char type;
+	unsigned char seq;
+	int len;
+	unsigned char payload[TLM_MAX_PAYLOAD];
+};
+
+int cobs_encode(unsigned char *src, int nbytes, unsigned char *dst);
+int cobs_decode(unsigned char *src, int nbytes, unsigned char *dst);
+
+int tlm_frame_encode(int type, int seq, unsigned char *payload, int len,
+	unsigned char *dst);
+int tlm_frame_decode(unsigned char *src, int nbytes, struct tlm_frame *f);
+
+int tlm_send(int type, unsigned char *payload, int len);
+void tlm_rx_enable(int enable);
+int tlm_receive(struct tlm_frame *f);
+int tlm_wait(struct tlm_frame *f);
@@ -0,0 +1,37 @@
+/* 
+ * watch.h - live variable watch and telemetry streamer definitions
+ *
+ * History
+ * 18 October 2026 - agent@local
+ *  - created
+ */
+
+/* maximum number of registered variables */
+#define WATCH_MAX	32
+
+/* variable types, low nibble is the size in bytes, 0x80 is unsigned */
+#define WATCH_CHAR	0x01
+#define WATCH_SHORT	0x02
+#define WATCH_LONG	0x04
+#define WATCH_UCHAR	0x81
+#define WATCH_USHORT	0x82
+#define WATCH_ULONG	0x84
+#define WATCH_INT	WATCH_LONG	/* int is 32 bits on the CPU32 */
+#define WATCH_UINT	WATCH_ULONG
+
+#define WATCH_SIZE(type)	((type) & 0x0f)
+#define WATCH_SIGNED(type)	(((type) & 0x80) == 0)
+
+struct watch_var
+{
+	const char *name;
+	int type;
+	volatile void *addr;
+};
+
+int watch_register(const char *name, int type, volatile void *addr);
+int watch_find(const char *name);
+int watch_select(const char *name, int on);
+void watch_rate(int period);
+int watch_command(char *line);
+int watch_start(int period, int listen);
@@ -21,6 +21,9 @@
  * 08 Oct 2004 dpa - Created
  *
  * 30 Dec 2006 rsr - Normalize identation
+ *
+ * 18 Oct 2026 agt - Fixed operator precedence in mrm_getc(), which returned
+ *                   the comparison result rather than the character.
  */
 
 /*
@@ -72,7 +75,7 @@ char mrm_getc(int fd)
 {
 	int c;
 
-	while (c = sci_getc() < 0)
+	while ((c = sci_getc()) < 0)
 		defer();
 	return (char)(c);
 }
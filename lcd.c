@@ -8,7 +8,8 @@
  * A first-in-first-out circular buffer to send characters to the display.
  *
  * lcd_service() should be run from the 1 kHz system clock interrupt. It 
- * tests each 1ms for FIFO EMPTY, and writes a char to LCD if available.
+ * tests each 1ms for FIFO EMPTY, and writes a burst of chars to the LCD
+ * if available.
  *
  * Uses the queue structure and functions from "queue.h"
  *
@@ -29,6 +30,26 @@
  *
  * 30 Dec 2006 rsr - Normalized identation
  *
+ * 18 Oct 2026 agt - Added a shadow framebuffer and lcd_put_at(). The state
+ *                   machine sends only cells that differ from what is on
+ *                   the display, addressing the cursor as needed. Text that
+ *                   runs off the last line now wraps to the first.
+ *
+ * 18 Oct 2026 agt - lcd_service() sends up to lcd_burst characters per tick
+ *                   while the display is ready, with a bounded busy wait.
+ *
+ * 18 Oct 2026 agt - Geometry is set at run time with lcd_set_geometry(),
+ *                   using the HD44780 row base addresses for 1 to 4 lines.
+ *
+ * 18 Oct 2026 agt - The power-on sequence runs as timed states of the
+ *                   service state machine. lcd_init_task is gone;
+ *                   lcd_display_init() restarts the sequence and waits for
+ *                   it.
+ *
+ * 18 Oct 2026 agt - Custom glyphs: lcd_define_glyph() queues a CGRAM upload
+ *                   that the state machine does between framebuffer
+ *                   updates.
+ *
  * \todo Should lcd_busy_wait() be type void?
  *
  */
@@ -56,10 +77,14 @@
 
 #define LCD_ROWS 2
 #define LCD_COLUMNS 24
+#define LCD_MAX_ROWS 4
+#define LCD_MAX_COLUMNS 40
+#define LCD_MAX_CELLS 80       /* display RAM of one HD44780 */
+#define LCD_CELLS (lcd_rows * lcd_columns)
 #define LCD_BUF_SIZE 100
 
 /**
- * 64 byte LCD FIFO
+ * 100 byte LCD FIFO
  */
 char lcd_buf[LCD_BUF_SIZE];
 
@@ -69,9 +94,54 @@ char lcd_buf[LCD_BUF_SIZE];
 queue_struct lcdq;
 
 /**
- * Number of characters output to LCD
+ * Display geometry, see lcd_set_geometry()
+ */
+int lcd_rows = LCD_ROWS, lcd_columns = LCD_COLUMNS;
+
+/**
+ * Row and column where the next character from the FIFO goes
+ */
+int lcd_row, lcd_col;
+
+/**
+ * Framebuffer: the wanted display contents, row by row
+ */
+char lcd_fb[LCD_MAX_CELLS];
+
+/**
+ * What is actually on the display, row by row
  */
-int lcd_count;
+char lcd_shown[LCD_MAX_CELLS];
+
+/**
+ * Set when lcd_fb may differ from lcd_shown
+ */
+volatile int lcd_fb_dirty;
+
+/**
+ * Next framebuffer cell to compare
+ */
+int lcd_fb_pos;
+
+/**
+ * Current display RAM address of the LCD cursor, -1 if unknown
+ */
+int lcd_addr = -1;
+
+/**
+ * Custom glyph bitmaps, 8 rows of 5 bits each
+ */
+unsigned char lcd_glyph[8][8];
+
+/**
+ * Bit n set when glyph n must be sent to the display CGRAM
+ */
+volatile int lcd_glyph_pending;
+
+/**
+ * Glyph being sent and its next row, -1 if none
+ */
+int lcd_cg_glyph = -1, lcd_cg_row;
 
 
 /**
@@ -81,7 +151,7 @@ int lcd_count;
  */
 int lcd_busy()
 {
-	if (((*(unsigned char*)LCD_REG) & 0x80) == 0x80)
+	if (((*(volatile unsigned char*)LCD_REG) & 0x80) == 0x80)
 		return -1;
 
 	return 0;
@@ -133,70 +203,257 @@ int lcd_write_data(char val) {
 void (*lcd_state)();
 
 
+/**
+ * Default maximum LCD state machine steps (characters or commands) per
+ * 1 ms tick
+ */
+#define LCD_BURST 2
+
+/**
+ * Default maximum busy flag polls per 1 ms tick. An HD44780 is ready
+ * again about 40 us after a character, so this is enough for one wait
+ * and keeps the time spent in the interrupt, where it holds off the SCI
+ * and QSPI interrupts at the same level, well under one character time
+ * at 115200 baud.
+ */
+#define LCD_BURST_POLLS 24
+
+/**
+ * Maximum state machine steps per tick, see lcd_set_burst()
+ */
+int lcd_burst = LCD_BURST;
+
+/**
+ * Maximum busy flag polls per tick, see lcd_set_burst()
+ */
+int lcd_burst_polls = LCD_BURST_POLLS;
+
+
+/**
+ * Set how much work lcd_service() may do in each 1 ms tick. More gives
+ * faster screen updates at the cost of interrupt time, which delays the
+ * SCI interrupt; at high baud rates received bytes may then be lost.
+ *
+ * @param steps Maximum characters or commands sent per tick, at least 1.
+ * 1 gives the original one character per millisecond.
+ * @param polls Maximum busy flag polls per tick while waiting for the
+ * display to become ready between steps, at least 1
+ */
+void lcd_set_burst(int steps, int polls)
+{
+	lcd_burst = (steps < 1) ? 1 : steps;
+	lcd_burst_polls = (polls < 1) ? 1 : polls;
+}
+
+
 /**
  * LCD display state machine service function. This function should be
- * run from the 1 kHz system clock interrupt. It never actually waits 
- * on busy state as LCD is always ready within 1ms (except during the
- * initialization period). When LCD is busy, the character just waits
- * in the FIFO for another 1ms interrupt.
+ * run from the 1 kHz system clock interrupt. It runs the state machine
+ * up to lcd_burst times, waiting for the busy flag between steps for at
+ * most lcd_burst_polls polls in all. The first step always runs, so a
+ * state can act (e.g. time out) even if the display stays busy. When
+ * LCD stays busy, the character just waits in the FIFO for another 1ms
+ * interrupt.
  */
 void lcd_service()
 {
-	if (lcd_state)
+	int n, polls;
+
+	polls = lcd_burst_polls;
+
+	for (n = 0; (n < lcd_burst) && lcd_state; n++) {
+		while (n && lcd_busy()) {
+			if (--polls <= 0)
+				return;
+		}
 		(*lcd_state)();
+	}
+}
+
+
+/**
+ * Display RAM address of a row and column. Lines 0 and 1 start at 0x00
+ * and 0x40; on 4 line modules lines 2 and 3 continue them, starting one
+ * row length further on.
+ */
+static int lcd_ddram(int row, int col)
+{
+	return ((row & 1) ? 0x40 : 0x00) + ((row & 2) ? lcd_columns : 0) + col;
+}
+
+
+/**
+ * Move the LCD cursor to a display RAM address if it is not already
+ * there.
+ *
+ * @return 0 if the cursor is in place, -1 if a command was sent or the
+ * LCD was busy (try again next time)
+ */
+static int lcd_goto(int addr)
+{
+	if (lcd_addr == addr)
+		return 0;
+	if (lcd_write_reg(0x80 | addr) == 0)
+		lcd_addr = addr;
+	return -1;
+}
+
+
+/**
+ * Fill the framebuffer and shadow with spaces, as after a clear command
+ */
+static void lcd_fb_clear()
+{
+	int i;
+
+	for (i = 0; i < LCD_CELLS; i++)
+		lcd_fb[i] = lcd_shown[i] = ' ';
 }
 
 
 /**
- * Output a character from FIFO to LCD.
+ * Output a character from FIFO to LCD. When the FIFO is empty, hands
+ * over to lcd_fb_state() if the framebuffer has changed.
  *
  * newline (\\n) = clear screen, home cursor
  *
- * tab (\\t) = set cursor to 2nd line
+ * tab (\\t) = set cursor to start of next line
  *
- * \note Wrap will occur if character count >= LCD_COLUMNS, by
- * setting cursor to start of 2nd row and bumping char count (character
- * will be printed next time).
+ * \note Text wraps to the next line at the end of a line, and from the
+ * last line back to the first.
  */
 void lcd_state0()
 {
 	int byte;
 	void extern lcd_state1();
+	void extern lcd_fb_state();
 
 	/* fetch the next byte from the queue */
 	byte = qfetch(&lcdq);
 
-	if (byte >= 0) {
-		if (byte == 9) {                         /* Is this byte a tab? */
-			if (lcd_write_reg(0xC0) == 0) {       /* set cursor to 2nd line */
-				qincr_o(&lcdq);                    /* discard byte from fifo */
-				lcd_count = LCD_COLUMNS+1;         /* and reset char count */
-			}
-		} else {
-			if (byte == 10) {                     /* Is this byte a newline? */
-				lcd_state = lcd_state1;            /* set state=1 for cls & home*/
-				qincr_o(&lcdq);                    /* discard byte from fifo */
-			} else {
-				if (lcd_count == LCD_COLUMNS) {     /* at end of 1st line? */
-					if (lcd_write_reg(0xC0) == 0) {  /* set cursor to second line*/
-						lcd_count++;                  /* if status ok bump count */
-					}
-				} else {
-					if (lcd_write_data(byte) == 0) { /* send char to lcd */
-						qincr_o(&lcdq);               /* if status ok, incr fifo */
-						lcd_count++;                  /* character count */
-					}
-				}
-			}
-		}
-	} else {                                     /* buffer is empty */
-		lcd_state = 0;                            /* turn off interrupt */
+	if (byte < 0) {                              /* buffer is empty */
+		if (lcd_fb_dirty || lcd_glyph_pending)
+			lcd_state = lcd_fb_state;          /* update changed cells */
+		else
+			lcd_state = 0;                     /* turn off interrupt */
+		return;
+	}
+
+	if (byte == 9) {                             /* Is this byte a tab? */
+		qincr_o(&lcdq);                           /* discard byte from fifo */
+		lcd_row = (lcd_row + 1) % lcd_rows;       /* next line */
+		lcd_col = 0;
+		return;
+	}
+
+	if (byte == 10) {                            /* Is this byte a newline? */
+		lcd_state = lcd_state1;                   /* set state=1 for cls & home*/
+		qincr_o(&lcdq);                           /* discard byte from fifo */
+		return;
+	}
+
+	if (lcd_col >= lcd_columns) {                /* at end of line? */
+		lcd_row = (lcd_row + 1) % lcd_rows;       /* wrap to next line */
+		lcd_col = 0;
+	}
+
+	if (lcd_goto(lcd_ddram(lcd_row, lcd_col)))   /* cursor in place? */
+		return;
+
+	if (lcd_write_data(byte) == 0) {             /* send char to lcd */
+		qincr_o(&lcdq);                           /* if status ok, incr fifo */
+		lcd_fb[lcd_row * lcd_columns + lcd_col] = byte;
+		lcd_shown[lcd_row * lcd_columns + lcd_col] = byte;
+		lcd_col++;
+		lcd_addr++;
+	}
+}
+
+
+/**
+ * Send one step of a glyph upload: the CGRAM address, then one row at
+ * a time. Leaves the cursor address unknown so the next character moves
+ * it back to display RAM.
+ */
+static void lcd_glyph_step()
+{
+	int n;
+
+	if (lcd_cg_glyph < 0) {                      /* start the next glyph */
+		for (n = 0; n < 8; n++)
+			if (lcd_glyph_pending & (1 << n))
+				break;
+		if (lcd_write_reg(0x40 | (n << 3)))
+			return;
+		lcd_glyph_pending &= ~(1 << n);           /* redefined later = resend */
+		lcd_cg_glyph = n;
+		lcd_cg_row = 0;
+		lcd_addr = -1;
+		return;
+	}
+
+	if (lcd_write_data(lcd_glyph[lcd_cg_glyph][lcd_cg_row]) == 0) {
+		if (++lcd_cg_row >= 8)
+			lcd_cg_glyph = -1;
+	}
+}
+
+
+/**
+ * Framebuffer update. Finds the next cell whose wanted contents differ
+ * from the display and sends it, moving the cursor first if needed.
+ * Characters from the FIFO take priority, except that a glyph upload is
+ * finished first and pending glyphs go before changed cells.
+ */
+void lcd_fb_state()
+{
+	int n, row, col;
+
+	if (lcd_cg_glyph >= 0) {                     /* finish glyph upload */
+		lcd_glyph_step();
+		return;
+	}
+
+	if (qfetch(&lcdq) >= 0) {                    /* FIFO output first */
+		lcd_state = lcd_state0;
+		return;
+	}
+
+	if (lcd_glyph_pending) {                     /* then new glyphs */
+		lcd_glyph_step();
+		return;
+	}
+
+	for (n = 0; n < LCD_CELLS; n++) {            /* find a changed cell */
+		if (lcd_fb[lcd_fb_pos] != lcd_shown[lcd_fb_pos])
+			break;
+		if (++lcd_fb_pos >= LCD_CELLS) lcd_fb_pos = 0;
+	}
+
+	if (n == LCD_CELLS) {                        /* all up to date */
+		lcd_fb_dirty = 0;
+		lcd_state = lcd_state0;
+		return;
+	}
+
+	row = lcd_fb_pos / lcd_columns;
+	col = lcd_fb_pos % lcd_columns;
+
+	if (lcd_goto(lcd_ddram(row, col)))
+		return;
+
+	if (lcd_write_data(lcd_fb[lcd_fb_pos]) == 0) {
+		lcd_shown[lcd_fb_pos] = lcd_fb[lcd_fb_pos];
+		lcd_addr++;
+		if (++lcd_fb_pos >= LCD_CELLS) lcd_fb_pos = 0;
 	}
 }
 
 
 /**
  * Clear screen, stage 1. Initiates cls and sets state to cls state 2.
+ * While waiting for the next FIFO character it keeps drawing framebuffer
+ * changes, staying in this state so the clear is still done.
  */
 void lcd_state1() 
 {
@@ -206,7 +463,11 @@ void lcd_state1()
 	if (qfetch(&lcdq) >= 0) {           /* if we have a char */
 		if (lcd_write_reg(0x01) == 0) {  /* initiate clear screen */
 			lcd_state = lcd_state2;       /* and set next state if status ok */
+			lcd_fb_clear();               /* display is now blank */
 		}
+	} else if (lcd_fb_dirty || lcd_glyph_pending || (lcd_cg_glyph >= 0)) {
+		lcd_fb_state();                  /* lcd_put_at() meanwhile */
+		lcd_state = lcd_state1;
 	}
 }
 
@@ -226,82 +487,145 @@ void lcd_state2()
 
 
 /**
- * Clear screen, stage 3. Homes the cursor and resets state and count.
+ * Clear screen, stage 3. Homes the cursor and resets state and position.
  */
 void lcd_state3() 
 {
 	if (lcd_write_reg(0x02) == 0) {  /* home cursor */
 		lcd_state = lcd_state0;       /* reset state */
-		lcd_count = 0;                /* and count */
+		lcd_row = lcd_col = 0;        /* and position */
+		lcd_addr = 0;
 	}
 }
 
 
 /**
- * Initializes the LCD HD44780 driver chip. Initial state is display on,
- * no cursor, no blink.
+ * Global LCD availability flag. 1 = available.
  */
-int lcd_display_init() {
+int lcd_available;
 
-	int i;
 
-	lcd_write_reg(0x30);   /* function set 8-bit interface */
-	msleep(5);             /* wait more than 4.1 ms */
+/**
+ * HD44780 power-on command sequence: 8 bit interface three times, two
+ * lines, display off, clear, entry mode increment with no shift, and
+ * display on with no cursor and no blink.
+ */
+static const unsigned char lcd_init_cmd[] = {
+	0x30, 0x30, 0x30, 0x38, 0x08, 0x01, 0x06, 0x0c
+};
+
+/**
+ * Milliseconds to wait after each command of lcd_init_cmd. The first
+ * needs more than 4.1 ms and the next two more than 100 usecs; after
+ * that the busy flag is valid and the service waits on it.
+ */
+static const unsigned char lcd_init_wait[] = {
+	5, 1, 1, 0, 0, 0, 0, 0
+};
+
+#define LCD_INIT_STEPS (sizeof(lcd_init_cmd) / sizeof(lcd_init_cmd[0]))
 
-	lcd_write_reg(0x30);   /* repeat function set */
-	msleep(1);             /* wait more than 100 usecs */
+/**
+ * Give up on the display if init has not finished in this many ms
+ */
+#define LCD_INIT_TIMEOUT 100
 
-	lcd_write_reg(0x30);   /* repeat function set one more time */
-	msleep(1);             /* wait more than 100 usecs */
+/**
+ * Next step of the init sequence
+ */
+int lcd_init_step;
 
-	lcd_write_reg(0x38);   /* 8 bit bus with two-line display */
-	lcd_busy_wait();
+/**
+ * sysclock values when init started and when the next step may run
+ */
+long lcd_init_start, lcd_init_time;
 
-	lcd_write_reg(0x08);   /* turn off display and cursor */
-	lcd_busy_wait();
 
-	lcd_write_reg(0x01);   /* clear display */
-	lcd_busy_wait();
+/**
+ * Initialization state. Sends one command of the power-on sequence each
+ * time its wait has passed. When done it sets lcd_available and starts
+ * any output queued meanwhile. If the display never becomes ready (not
+ * fitted) the state machine is turned off and lcd_available stays 0.
+ */
+void lcd_init_state()
+{
+	extern long sysclock;
+	int i;
 
-	lcd_write_reg(0x06);   /* entry mode increment by 1, no shift */
-	lcd_busy_wait();
+	if (sysclock - lcd_init_start > LCD_INIT_TIMEOUT) {
+		lcd_state = 0;                      /* no display */
+		return;
+	}
 
-	lcd_write_reg(0x0c);   /* turn on display; no cursor; no blink */
-	lcd_busy_wait();
+	if (sysclock < lcd_init_time)          /* still waiting */
+		return;
 
-	return 0;
+	if (lcd_write_reg(lcd_init_cmd[lcd_init_step]))
+		return;
+
+	/* +1 as the current tick is already partly over */
+	if (lcd_init_wait[lcd_init_step])
+		lcd_init_time = sysclock + lcd_init_wait[lcd_init_step] + 1;
+
+	if (++lcd_init_step < LCD_INIT_STEPS)
+		return;
+
+	for (i = 0; i < LCD_MAX_CELLS; i++)    /* display is blank */
+		lcd_shown[i] = ' ';
+	lcd_fb_dirty = 1;                      /* lcd_put_at() during init */
+	lcd_row = lcd_col = 0;
+	lcd_addr = 0;
+	lcd_available = 1;
+	lcd_state = lcd_state0;                /* send anything queued */
 }
 
 
 /**
- * Global LCD availability flag. 1 = available.
+ * Starts the LCD HD44780 initialization in the 1 kHz state machine.
+ * Initial state is display on, no cursor, no blink.
  */
-int lcd_available;
+static void lcd_init_begin()
+{
+	extern long sysclock;
+
+	lcd_state = 0;
+	lcd_available = 0;
+	lcd_init_step = 0;
+	lcd_init_start = lcd_init_time = sysclock;
+	lcd_state = lcd_init_state;
+}
 
 
 /**
- * LCD Initialization task for multi-tasking execution. This function
- * should be called with create_task() after multi-tasking is started
+ * Reinitializes the LCD HD44780 driver chip and waits in a defer() loop
+ * until it is done. Not needed at startup, where lcd_init() starts the
+ * same sequence without blocking.
+ *
+ * @return 0 if the display is ready, -1 if it did not respond
  */
-void lcd_init_task(int x)
-{
-	lcd_display_init();
-	lcd_available = 1;
-	terminate();
+int lcd_display_init() {
+
+	lcd_init_begin();
+	while (lcd_state == lcd_init_state) defer();
+
+	return lcd_available ? 0 : -1;
 }
 
 
 /**
- * Initializes the LCD FIFO and creates the LCD hardware init task.
+ * Initializes the LCD FIFO and starts the hardware init, which runs from
+ * lcd_service() once the 1 kHz interrupt is going. Characters written
+ * before then are queued and shown when the display is ready.
  */
 int lcd_init()
 {
 
-	/* setup LCD output fifo */
+	/* setup LCD output fifo and framebuffer */
 	q_init(&lcdq, &lcd_buf[0], LCD_BUF_SIZE);
+	lcd_fb_clear();
 
-	/* create hardware init task for later execution by scheduler */
-	create_task(lcd_init_task,0,256);
+	/* hardware init is done by the service state machine */
+	lcd_init_begin();
 
 	return 0;
 }
@@ -323,3 +647,105 @@ int lcd_putc(char byte)
 
 	return(0);
 }
+
+
+/**
+ * Write a string into the LCD framebuffer. Only characters that differ
+ * from what is on the display are sent, by the 1 kHz service, so a
+ * status screen can be redrawn in full every time without flicker.
+ * Output is clipped at the end of the row. Does not block.
+ *
+ * @param row Row, 0 is the top
+ * @param col Column, 0 is the left
+ * @param str NUL terminated string
+ * @return Number of characters written or -1 if row or col is out of range
+ */
+int lcd_put_at(int row, int col, char *str)
+{
+	char *p;
+	int n;
+
+	if ((row < 0) || (row >= lcd_rows) || (col < 0) || (col >= lcd_columns))
+		return -1;
+
+	p = &lcd_fb[row * lcd_columns + col];
+	for (n = 0; str[n] && (col + n < lcd_columns); n++)
+		p[n] = str[n];
+
+	lcd_fb_dirty = 1;
+	if ((lcd_state == 0) && (lcd_available)) {
+		lcd_state = lcd_state0;  /* turn interrupt on */
+	}
+
+	return n;
+}
+
+
+/**
+ * Set the display geometry, e.g. 2x24 (the default), 2x16 or 4x20. The
+ * framebuffer is blanked and the whole display rewritten with spaces
+ * by the service; FIFO output continues at the top left.
+ *
+ * @param rows Number of lines, 1 to 4
+ * @param cols Characters per line, at most 40 and at most 80 cells in all
+ * @return 0 if ok, -1 if the geometry is not supported
+ */
+int lcd_set_geometry(int rows, int cols)
+{
+	void (*state)();
+	int i;
+
+	if ((rows < 1) || (rows > LCD_MAX_ROWS) || (cols < 1) ||
+	    (cols > LCD_MAX_COLUMNS) || (rows * cols > LCD_MAX_CELLS))
+		return -1;
+
+	state = lcd_state;             /* hold off the service */
+	lcd_state = 0;
+
+	lcd_rows = rows;
+	lcd_columns = cols;
+	lcd_row = lcd_col = 0;
+	lcd_fb_pos = 0;
+	for (i = 0; i < LCD_MAX_CELLS; i++) {
+		lcd_fb[i] = ' ';
+		lcd_shown[i] = 0;         /* unknown, so every cell is sent */
+	}
+	lcd_fb_dirty = 1;
+
+	if (state)
+		lcd_state = state;
+	else if (lcd_available)
+		lcd_state = lcd_state0;
+
+	return 0;
+}
+
+
+/**
+ * Define custom glyph n. The glyph is shown by character code n or n+8;
+ * use LCD_GLYPH(n) in strings, which avoids NUL and the tab and newline
+ * codes that lcd_putc() acts on. The upload is done by the 1 kHz
+ * service, so this does not block, and cells already showing the glyph
+ * change when it arrives.
+ *
+ * @param n Glyph number, 0 to 7
+ * @param rows 8 bytes, top row first, bit 4 is the leftmost pixel
+ * @return 0 if ok, -1 if n is out of range
+ */
+int lcd_define_glyph(int n, const unsigned char *rows)
+{
+	int i;
+
+	if ((n < 0) || (n > 7))
+		return -1;
+
+	for (i = 0; i < 8; i++)
+		lcd_glyph[n][i] = rows[i] & 0x1f;
+
+	lcd_glyph_pending |= 1 << n;
+	if ((lcd_state == 0) && (lcd_available)) {
+		lcd_state = lcd_state0;  /* turn interrupt on */
+	}
+
+	return 0;
+}
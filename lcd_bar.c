@@ -0,0 +1,169 @@
+/**
+ * \file lcd_bar.c
+ * \brief Bar graph widgets for the HD44780 LCD
+ *
+ * Draws horizontal or vertical bar graphs with sub-character resolution
+ * using custom glyphs. A horizontal bar has 5 steps per character and a
+ * vertical bar 8. Bars are drawn into the LCD framebuffer with
+ * lcd_put_at(), so redrawing a bar every loop only sends the one or two
+ * cells that changed.
+ *
+ * There are only 8 glyphs, so a display shows either horizontal or
+ * vertical bars, chosen with lcd_bar_mode(). Horizontal bars use glyphs
+ * 0-3 and vertical bars glyphs 0-6; the rest are free for the user.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "lcd_queue.h"
+
+#define LCD_BAR_FULL 0xff      /* solid block in the HD44780 A00 ROM */
+#define LCD_BAR_MAX 40         /* longest bar, one full line */
+
+/**
+ * Glyph set loaded for bars, LCD_BAR_H, LCD_BAR_V or 0 for none
+ */
+int lcd_bar_glyphs;
+
+
+/**
+ * Load the glyphs for horizontal or vertical bars. Called by the bar
+ * functions as needed, but switching modes changes any bars already on
+ * the display.
+ *
+ * @param mode LCD_BAR_H or LCD_BAR_V
+ * @return 0 if ok, -1 if mode is unknown
+ */
+int lcd_bar_mode(int mode)
+{
+	unsigned char rows[8];
+	int n, i;
+
+	if (mode == LCD_BAR_H) {
+		for (n = 0; n < 4; n++) {            /* n+1 columns from the left */
+			for (i = 0; i < 8; i++)
+				rows[i] = (0x1f << (4 - n)) & 0x1f;
+			lcd_define_glyph(n, rows);
+		}
+	} else if (mode == LCD_BAR_V) {
+		for (n = 0; n < 7; n++) {            /* n+1 rows from the bottom */
+			for (i = 0; i < 8; i++)
+				rows[i] = (i >= 7 - n) ? 0x1f : 0x00;
+			lcd_define_glyph(n, rows);
+		}
+	} else
+		return -1;
+
+	lcd_bar_glyphs = mode;
+	return 0;
+}
+
+
+/**
+ * Scale a value to a number of bar steps, clipped to 0..steps
+ */
+static int lcd_bar_fill(int value, int max, int steps)
+{
+	if (value <= 0)
+		return 0;
+	if (value >= max)
+		return steps;
+	return ((long)value * steps) / max;
+}
+
+
+/**
+ * Character for one cell of a bar holding fill steps of a cell
+ * with size steps
+ */
+static char lcd_bar_cell(int fill, int size)
+{
+	if (fill >= size)
+		return LCD_BAR_FULL;
+	if (fill > 0)
+		return LCD_GLYPH(fill - 1);
+	return ' ';
+}
+
+
+/**
+ * Draw a horizontal bar growing to the right.
+ *
+ * @param row Row of the bar
+ * @param col Column of the left end
+ * @param width Length in characters, 1 to 40
+ * @param value Value to show, clipped to 0..max
+ * @param max Value of a full bar, greater than 0
+ * @return 0 if ok, -1 if out of range
+ */
+int lcd_hbar(int row, int col, int width, int value, int max)
+{
+	char buf[LCD_BAR_MAX + 1];
+	int fill, i;
+
+	if ((width < 1) || (width > LCD_BAR_MAX) || (max <= 0))
+		return -1;
+
+	if (lcd_bar_glyphs != LCD_BAR_H)
+		lcd_bar_mode(LCD_BAR_H);
+
+	fill = lcd_bar_fill(value, max, width * 5);
+	for (i = 0; i < width; i++, fill -= 5)
+		buf[i] = lcd_bar_cell(fill, 5);
+	buf[width] = 0;
+
+	return (lcd_put_at(row, col, buf) < 0) ? -1 : 0;
+}
+
+
+/**
+ * Draw a vertical bar growing upwards.
+ *
+ * @param row Row of the top of the bar
+ * @param col Column of the bar
+ * @param height Height in lines, from row downwards
+ * @param value Value to show, clipped to 0..max
+ * @param max Value of a full bar, greater than 0
+ * @return 0 if ok, -1 if out of range
+ */
+int lcd_vbar(int row, int col, int height, int value, int max)
+{
+	extern int lcd_rows;
+	char cell[2];
+	int fill, i;
+
+	if ((height < 1) || (row < 0) || (row + height > lcd_rows) || (max <= 0))
+		return -1;
+
+	if (lcd_bar_glyphs != LCD_BAR_V)
+		lcd_bar_mode(LCD_BAR_V);
+
+	fill = lcd_bar_fill(value, max, height * 8);
+	cell[1] = 0;
+	for (i = row + height - 1; i >= row; i--, fill -= 8) {
+		cell[0] = lcd_bar_cell(fill, 8);
+		if (lcd_put_at(i, col, cell) < 0)
+			return -1;
+	}
+
+	return 0;
+}
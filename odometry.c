@@ -0,0 +1,287 @@
+/**
+ * \file odometry.c
+ * \brief Fixed point differential drive odometry
+ *
+ * Integrates the robot pose from the left and right drive encoder
+ * changes on every speedometer() sample, without floating point. Set it
+ * up with odometry_init() once the encoders are running and sampled at
+ * least every ODO_PERIOD (10) ms, see fqd_set_rate().
+ *
+ * Position x, y is kept in the application's distance units (mm, inches,
+ * ...) with ODO_FRAC fraction bits; heading is a 16 bit binary angle,
+ * 65536 = 360 degrees, counter-clockwise from the x axis. Each step moves
+ * the distance travelled along the mean heading of the step, using a
+ * sine table with interpolation. Tasks take a consistent copy of the pose
+ * with odometry_read().
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ * 18 Oct 2026 agt - odometry_set() masks interrupts instead of removing the
+ *                   speedometer hook.
+ *
+ * 18 Oct 2026 agt - odometry_init() requires a sample period of ODO_PERIOD
+ *                   or less.
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "fqd.h"
+#include "odometry.h"
+
+/**
+ * sin() of a quarter turn in 256 steps, 16384 = 1.0
+ */
+static const short odo_sintab[257] = {
+	    0,   101,   201,   302,   402,   503,   603,   704,   804,   904,
+	 1005,  1105,  1205,  1306,  1406,  1506,  1606,  1706,  1806,  1906,
+	 2006,  2105,  2205,  2305,  2404,  2503,  2603,  2702,  2801,  2900,
+	 2999,  3098,  3196,  3295,  3393,  3492,  3590,  3688,  3786,  3883,
+	 3981,  4078,  4176,  4273,  4370,  4467,  4563,  4660,  4756,  4852,
+	 4948,  5044,  5139,  5235,  5330,  5425,  5520,  5614,  5708,  5803,
+	 5897,  5990,  6084,  6177,  6270,  6363,  6455,  6547,  6639,  6731,
+	 6823,  6914,  7005,  7096,  7186,  7276,  7366,  7456,  7545,  7635,
+	 7723,  7812,  7900,  7988,  8076,  8163,  8250,  8337,  8423,  8509,
+	 8595,  8680,  8765,  8850,  8935,  9019,  9102,  9186,  9269,  9352,
+	 9434,  9516,  9598,  9679,  9760,  9841,  9921, 10001, 10080, 10159,
+	10238, 10316, 10394, 10471, 10549, 10625, 10702, 10778, 10853, 10928,
+	11003, 11077, 11151, 11224, 11297, 11370, 11442, 11514, 11585, 11656,
+	11727, 11797, 11866, 11935, 12004, 12072, 12140, 12207, 12274, 12340,
+	12406, 12472, 12537, 12601, 12665, 12729, 12792, 12854, 12916, 12978,
+	13039, 13100, 13160, 13219, 13279, 13337, 13395, 13453, 13510, 13567,
+	13623, 13678, 13733, 13788, 13842, 13896, 13949, 14001, 14053, 14104,
+	14155, 14206, 14256, 14305, 14354, 14402, 14449, 14497, 14543, 14589,
+	14635, 14680, 14724, 14768, 14811, 14854, 14896, 14937, 14978, 15019,
+	15059, 15098, 15137, 15175, 15213, 15250, 15286, 15322, 15357, 15392,
+	15426, 15460, 15493, 15525, 15557, 15588, 15619, 15649, 15679, 15707,
+	15736, 15763, 15791, 15817, 15843, 15868, 15893, 15917, 15941, 15964,
+	15986, 16008, 16029, 16049, 16069, 16088, 16107, 16125, 16143, 16160,
+	16176, 16192, 16207, 16221, 16235, 16248, 16261, 16273, 16284, 16295,
+	16305, 16315, 16324, 16332, 16340, 16347, 16353, 16359, 16364, 16369,
+	16373, 16376, 16379, 16381, 16383, 16384, 16384
+};
+
+/**
+ * Distance per encoder count in units, 16 fraction bits
+ */
+long odo_scale;
+
+/**
+ * Heading change per count of difference between the wheels, binary
+ * angle with 16 fraction bits
+ */
+long odo_turn;
+
+/**
+ * Heading, binary angle in the top 16 bits
+ */
+unsigned long odo_heading;
+
+/**
+ * Bits of x, y and distance below ODO_FRAC, carried between updates so
+ * that short steps do not lose distance
+ */
+long odo_xf, odo_yf, odo_df;
+
+/**
+ * Current pose, read it with odometry_read()
+ */
+volatile struct odometry_pose odometry_pose;
+
+/**
+ * Pose update count, odd while odometry_pose is being written
+ */
+volatile unsigned long odo_lock;
+
+
+/**
+ * Sine of a binary angle.
+ *
+ * @param a Angle, 65536 = 360 degrees
+ * @return sin(a), 16384 = 1.0
+ */
+int odometry_sin(unsigned a)
+{
+	int neg, i, f, s;
+
+	a &= 0xffff;
+	neg = a & 0x8000;
+	a &= 0x7fff;
+	if (a > 0x4000)
+		a = 0x8000 - a;              /* sin(180 - a) = sin(a) */
+
+	i = a >> 6;
+	f = a & 0x3f;
+	s = odo_sintab[i];
+	if (f)
+		s += ((odo_sintab[i + 1] - s) * f) >> 6;
+
+	return neg ? -s : s;
+}
+
+
+/**
+ * Cosine of a binary angle.
+ *
+ * @param a Angle, 65536 = 360 degrees
+ * @return cos(a), 16384 = 1.0
+ */
+int odometry_cos(unsigned a)
+{
+	return odometry_sin(a + 0x4000);
+}
+
+
+/**
+ * d * c / 16384 for a sine or cosine c, without overflow
+ */
+static long odo_mul14(long d, int c)
+{
+	return (d >> 14) * c + (((d & 0x3fff) * c) >> 14);
+}
+
+
+/**
+ * Advance the pose by one encoder sample. Run by speedometer() through
+ * speedometer_hook.
+ *
+ * @param left Left wheel counts since the last sample
+ * @param right Right wheel counts since the last sample
+ */
+void odometry_update(int left, int right)
+{
+	unsigned long diff;
+	long d;
+	unsigned mid;
+
+	if ((left == 0) && (right == 0))
+		return;
+
+	/* distance of the centre, 16 fraction bits */
+	d = ((long)(left + right) * odo_scale) >> 1;
+
+	/* heading wraps round, so do the turn in unsigned arithmetic and
+	   move along the heading half way through it */
+	diff = (unsigned long)(right - left);
+	mid = (odo_heading + diff * (unsigned long)(odo_turn >> 1)) >> 16;
+	odo_heading += diff * (unsigned long)odo_turn;
+
+	odo_xf += odo_mul14(d, odometry_cos(mid));
+	odo_yf += odo_mul14(d, odometry_sin(mid));
+	odo_df += d;
+
+	odo_lock++;
+	odometry_pose.x += odo_xf >> (16 - ODO_FRAC);
+	odometry_pose.y += odo_yf >> (16 - ODO_FRAC);
+	odometry_pose.distance += odo_df >> (16 - ODO_FRAC);
+	odometry_pose.heading = (odo_heading >> 16) & 0xffff;
+	odo_lock++;
+
+	odo_xf &= (1 << (16 - ODO_FRAC)) - 1;
+	odo_yf &= (1 << (16 - ODO_FRAC)) - 1;
+	odo_df &= (1 << (16 - ODO_FRAC)) - 1;
+}
+
+
+/**
+ * Copy the current pose. If the pose changes during the copy, the copy
+ * is simply done again.
+ *
+ * @param p Where to put the copy
+ */
+void odometry_read(struct odometry_pose *p)
+{
+	unsigned long lock;
+
+	do {
+		lock = odo_lock;
+		p->x = odometry_pose.x;
+		p->y = odometry_pose.y;
+		p->heading = odometry_pose.heading;
+		p->distance = odometry_pose.distance;
+	} while ((lock & 1) || (lock != odo_lock));
+}
+
+
+/**
+ * Set the pose. Interrupts are masked while it is reset, so an encoder
+ * sample is applied either before or after, never lost.
+ *
+ * @param x, y Position in units, ODO_FRAC fraction bits (ODO_UNITS(n))
+ * @param heading Binary angle, 65536 = 360 degrees
+ */
+void odometry_set(long x, long y, unsigned heading)
+{
+	unsigned short sr;
+
+	/* mask interrupts, a sample that comes meanwhile waits for the reset */
+	asm volatile ("move.w %%sr,%0\n\tori.w #0x0700,%%sr"
+		: "=d" (sr) : : "memory");
+
+	odo_heading = (unsigned long)(heading & 0xffff) << 16;
+	odo_xf = odo_yf = odo_df = 0;
+	odo_lock++;
+	odometry_pose.x = x;
+	odometry_pose.y = y;
+	odometry_pose.heading = heading & 0xffff;
+	odometry_pose.distance = 0;
+	odo_lock++;
+
+	asm volatile ("move.w %0,%%sr" : : "d" (sr) : "memory");
+}
+
+
+/**
+ * Set up odometry from encoders 0 (left) and 1 (right) and start it at
+ * pose 0, 0, 0. The pose is updated on every speedometer() sample, so
+ * the caller must first set a sample period of ODO_PERIOD ms or less
+ * with fqd_set_rate(); the default 50 ms is too slow. The rate applies
+ * to all encoders. fqd_set_rate(4, 50) or faster also keeps the fine
+ * velocity (left_fine etc.) working and leaves velocity in counts per
+ * 50 ms.
+ *
+ * @param counts Encoder counts for a travel of distance
+ * @param distance Distance travelled for counts, in units
+ * @param wheelbase Distance between the wheels, in units
+ * @return 0 if ok, -1 if a parameter is out of range (at most 3 units
+ * per count and a wheelbase of at least one unit) or the encoders are
+ * sampled too slowly
+ */
+int odometry_init(long counts, long distance, long wheelbase)
+{
+	long scale;
+
+	if ((counts <= 0) || (distance <= 0) || (wheelbase <= 0) ||
+	    (distance > 0x7fff) || (distance > 3 * counts) ||
+	    (spd_period > ODO_PERIOD))
+		return -1;
+
+	scale = ((distance << 16) + counts / 2) / counts;
+
+	speedometer_hook = 0;              /* no updates while it changes */
+
+	/* scale / wheelbase radians, times 65536 / 2pi = 10430.378 */
+	odo_turn = (scale * 10430 + (scale * 378) / 1000) / wheelbase;
+	odo_scale = scale;
+
+	odometry_set(0, 0, 0);
+	speedometer_hook = odometry_update;
+
+	return 0;
+}
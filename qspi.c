@@ -0,0 +1,271 @@
+/**
+ * \file qspi.c
+ * \brief Queued Serial Peripheral Interface (QSPI) driver
+ *
+ * Drives SPI devices such as A/D converters and IMUs from the QSPI half
+ * of the QSM. Up to 16 words, with a command byte each, are loaded into
+ * the QSM queue RAM and the QSPI then runs the whole queue with no CPU
+ * help, raising one interrupt at the end. In wrap-around mode the queue
+ * repeats forever, so the receive RAM always holds fresh readings.
+ *
+ * Typical use from a task:
+ *
+ *   struct qspi_dev adc;
+ *   unsigned short tx[3], rx[3];
+ *
+ *   qspi_init();
+ *   qspi_device(&adc, 1000000, 8, 0, QSPI_PCS(0));
+ *   ...
+ *   qspi_transfer(&adc, tx, rx, 3);
+ *
+ * qspi_transfer() calls defer() while the queue runs. Tasks share the bus
+ * in turn; a task that finds the QSPI in use waits for it. For full
+ * control, qspi_start() takes caller built command bytes, for example
+ * to address several devices (with the same SPCR0 settings) in one
+ * queue, and qspi_done()/qspi_finish() collect the results.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "qsm_reg.h"
+#include "qspi.h"
+
+#define QSPI_RX  ((volatile unsigned short *)QSM_RXRAM)
+#define QSPI_TX  ((volatile unsigned short *)QSM_TXRAM)
+#define QSPI_CMD ((volatile unsigned char *)QSM_CMDRAM)
+
+/**
+ * Driver state, one of the QSPI_ state values
+ */
+volatile int qspi_state;
+
+
+/**
+ * QSPI interrupt service. Runs when the queue has finished (SPIF).
+ */
+__attribute__((interrupt_handler)) void qspi_int(void)
+{
+	if (QSM_SPCR3_SPSR & 0x0080) {		/* SPIF */
+		QSM_SPCR3_SPSR = 0x0000;	/* clear SPIF */
+		qspi_state = QSPI_DONE;
+	}
+}
+
+
+/**
+ * Initializes the QSPI as bus master. Call after sci_init(), which sets
+ * up the QSM and its interrupt vector number.
+ */
+void qspi_init(void)
+{
+	extern int vbraddr;
+
+	QSM_SPCR1 = 0x0000;			/* QSPI off */
+	qspi_state = QSPI_IDLE;
+
+	*(long*)(vbraddr+QSPIVEC*4) = (long)qspi_int;	/* QSPI vector */
+
+	QSM_PORTQS = QSM_PORTQS | 0x78;		/* PCS0-3 idle high */
+	QSM_PQSPAR_DDR = 0x7b7e;		/* MISO, MOSI, PCS0-3 to QSPI */
+						/* SCK, MOSI, PCS0-3 outputs */
+
+	QSM_QILR_QIVR = (QSM_QILR_QIVR & ~0x3800) | (QSPI_LEVEL << 11);
+						/* bits 13-11 are QSPI priority */
+}
+
+
+/**
+ * Describe a device on the bus
+ *
+ * @param d Pointer to the device struct to fill in
+ * @param baud Maximum SCK rate in Hz. The QSPI divides cpu_clock by 4
+ * to 510, so at 25.166 MHz the range is 49 kHz to 6.29 MHz.
+ * @param bits Bits per transfer, 8 to 16
+ * @param mode SPI mode 0 to 3 (bit 1 = CPOL, bit 0 = CPHA)
+ * @param pcs Chip select levels while the device is selected, normally
+ * QSPI_PCS(n) for an active low select on PCSn
+ * @return The actual SCK rate or -1 if a parameter is out of range
+ */
+long qspi_device(struct qspi_dev *d, long baud, int bits, int mode, int pcs)
+{
+	extern long cpu_clock;
+	long spbr;
+
+	if ((baud <= 0) || (bits < 8) || (bits > 16) || (mode < 0) || (mode > 3))
+		return -1;
+
+	spbr = (cpu_clock + 2 * baud - 1) / (2 * baud);	/* round down rate */
+	if (spbr < 2) spbr = 2;
+	if (spbr > 255)
+		return -1;
+
+	d->spcr0 = 0x8000 |			/* master */
+		   ((bits & 0x0f) << 10) |	/* 16 bits is coded as 0 */
+		   (mode << 8) |		/* CPOL, CPHA */
+		   spbr;
+	d->pcs = pcs & 0x0f;
+
+	return cpu_clock / (2 * spbr);
+}
+
+
+/**
+ * Load and start a queue. Waits, calling defer(), while another task is
+ * using the QSPI.
+ *
+ * @param d Device settings for the whole queue
+ * @param cmd Command byte for each word (QSPI_ bits and PCS levels)
+ * @param tx Words to send
+ * @param n Number of words, 1 to QSPI_QUEUE_SIZE
+ * @param wrap Zero to run the queue once and interrupt at the end, or
+ * non-zero to repeat it until qspi_stop()
+ * @return 0 if started or -1 if n is out of range
+ */
+int qspi_start(struct qspi_dev *d, unsigned char *cmd, unsigned short *tx,
+	int n, int wrap)
+{
+	int i;
+
+	if ((n < 1) || (n > QSPI_QUEUE_SIZE))
+		return -1;
+
+	while (qspi_state != QSPI_IDLE) defer();
+	qspi_state = wrap ? QSPI_CONTINUOUS : QSPI_RUNNING;
+
+	for (i = 0; i < n; i++) {
+		QSPI_TX[i] = tx[i];
+		QSPI_CMD[i] = cmd[i];
+	}
+
+	QSM_SPCR0 = d->spcr0;
+	QSM_SPCR3_SPSR = 0x0000;		/* clear status and HALT */
+
+	if (wrap)
+		QSM_SPCR2 = 0x4000 | ((n - 1) << 8);	/* WREN, ENDQP, NEWQP 0 */
+	else
+		QSM_SPCR2 = 0x8000 | ((n - 1) << 8);	/* SPIFIE, ENDQP, NEWQP 0 */
+
+	QSM_SPCR1 = 0x8000;			/* SPE, go */
+
+	return 0;
+}
+
+
+/**
+ * Test whether a one-shot queue has finished
+ *
+ * @return 1 if the results are ready, 0 if not
+ */
+int qspi_done(void)
+{
+	return (qspi_state == QSPI_DONE);
+}
+
+
+/**
+ * Wait for a one-shot queue to finish, calling defer(), then collect the
+ * received words and release the QSPI to other tasks
+ *
+ * @param rx Buffer for the received words, may be 0 to discard them
+ * @param n Number of words to copy
+ * @return n, or -1 if no one-shot queue was started
+ */
+int qspi_finish(unsigned short *rx, int n)
+{
+	int i;
+
+	if ((qspi_state != QSPI_RUNNING) && (qspi_state != QSPI_DONE))
+		return -1;
+
+	while (qspi_state != QSPI_DONE) defer();
+
+	if (rx) {
+		for (i = 0; i < n; i++)
+			rx[i] = QSPI_RX[i];
+	}
+	qspi_state = QSPI_IDLE;
+
+	return n;
+}
+
+
+/**
+ * Exchange up to 16 words with one device, holding its chip select
+ * asserted for the whole transaction. Calls defer() while waiting.
+ *
+ * @param d Device
+ * @param tx Words to send
+ * @param rx Buffer for the received words, may be 0
+ * @param n Number of words, 1 to QSPI_QUEUE_SIZE
+ * @return n or -1 if n is out of range
+ */
+int qspi_transfer(struct qspi_dev *d, unsigned short *tx, unsigned short *rx,
+	int n)
+{
+	unsigned char cmd[QSPI_QUEUE_SIZE];
+	int i;
+
+	if ((n < 1) || (n > QSPI_QUEUE_SIZE))
+		return -1;
+
+	for (i = 0; i < n; i++)
+		cmd[i] = QSPI_CONT | QSPI_BITSE | d->pcs;
+	cmd[n - 1] &= ~QSPI_CONT;		/* release select at the end */
+
+	qspi_start(d, cmd, tx, n, 0);
+	return qspi_finish(rx, n);
+}
+
+
+/**
+ * Copy the latest received words while a wrap-around queue is running.
+ * Each word is updated by the QSPI independently, so words from one
+ * pass of the queue may be mixed with the next.
+ *
+ * @param rx Buffer for the received words
+ * @param n Number of words to copy
+ */
+void qspi_read(unsigned short *rx, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		rx[i] = QSPI_RX[i];
+}
+
+
+/**
+ * Stop a wrap-around queue at the end of the current word and release
+ * the QSPI to other tasks
+ */
+void qspi_stop(void)
+{
+	if (qspi_state != QSPI_CONTINUOUS)
+		return;
+
+	QSM_SPCR3_SPSR = 0x0100;		/* HALT */
+	while ((QSM_SPCR3_SPSR & 0x0020) == 0) defer();	/* HALTA */
+
+	QSM_SPCR1 = 0x0000;			/* SPE off */
+	QSM_SPCR3_SPSR = 0x0000;		/* clear HALT and status */
+	qspi_state = QSPI_IDLE;
+}
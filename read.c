@@ -13,6 +13,10 @@
  *
  * 30 Dec 2006 rsr - Normalize indentation
  *
+ * 18 Oct 2026 agt - Copy everything already in the receive FIFO per pass
+ *                   with sci_read() instead of one mrm_getc() call per
+ *                   byte.
+ *
  */
 
  /*
@@ -50,11 +54,14 @@
 #include "glue.h"
 
 /* extern char _DEFUN_VOID (inbyte); */
-extern char _EXFUN (mrm_getc, (int fd));
+extern int  _EXFUN (sci_read, (char *buf, int nbytes));
+extern void _EXFUN (defer, (void));
 
 /**
  * Reads bytes from the serial port. fd = 0 for stdin.  We really only
- * have stdin.  Pass it to mrm_getc() anyway.
+ * have stdin, so fd is ignored. Blocks, calling defer(), until nbytes
+ * have been read. Use sci_read() or sci_read_timed() to take only what
+ * has arrived or to give up after a deadline.
  */
 int
 _DEFUN (read, (fd, buf, nbytes),
@@ -64,8 +71,10 @@ _DEFUN (read, (fd, buf, nbytes),
 {
 	int i = 0;
 
-	for (i = 0; i < nbytes; i++) {
-		*(buf + i) = mrm_getc(fd);
+	while (1) {
+		i += sci_read(buf + i, nbytes - i);
+		if (i >= nbytes) break;
+		defer();
 	}
 	return (i);
 }
@@ -12,6 +12,30 @@
  *
  * 30 Dec 2006 rsr - Normalized indentation
  *
+ * 18 Oct 2026 agt - Added sci_write() to copy whole buffers into the
+ *                   transmit FIFO with a single TDRE enable.
+ *
+ * 18 Oct 2026 agt - Added non-blocking sci_read() and sci_read_timed().
+ *
+ * 18 Oct 2026 agt - Added sci_rx_hook so a link layer can take received
+ *                   bytes in the interrupt before they reach the receive
+ *                   FIFO.
+ *
+ * 18 Oct 2026 agt - Baud rate is now computed from cpu_clock. Added
+ *                   sci_init_baud() and sci_set_baud().
+ *
+ * 18 Oct 2026 agt - Added sci_set_buffers() for application supplied FIFO
+ *                   buffers.
+ *
+ * 18 Oct 2026 agt - Added receive unit tracking (sci_set_delimiter(),
+ *                   sci_set_length_prefix(), sci_get_unit()) so consumers
+ *                   wake once per line or frame instead of once per byte.
+ *
+ * 18 Oct 2026 agt - Unit mode may be set before sci_init().
+ *
+ * 18 Oct 2026 agt - sci_read() and sci_get_unit() release FIFO space with
+ *                   interrupts masked and keep bytes the interrupt dropped.
+ *
  * \todo inbyte() needs better description
  * \todo outbyte() needs better description
  * \todo interrupt handler routine needs better description
@@ -42,7 +66,7 @@
 #include "queue.h"
 
 /**
- * Size of SCI transmit and receive buffers
+ * Size of default SCI transmit and receive buffers
  */
 #define SCI_BUF_SIZE 128
 
@@ -56,6 +80,12 @@ char tx_buf[SCI_BUF_SIZE];
  */
 char rx_buf[SCI_BUF_SIZE];
 
+/**
+ * Buffers and sizes used for the SCI FIFOs, see sci_set_buffers()
+ */
+char *sci_tx_buf = tx_buf, *sci_rx_buf = rx_buf;
+int sci_tx_size = SCI_BUF_SIZE, sci_rx_size = SCI_BUF_SIZE;
+
 
 /**
  * queue struct thingies? need better desc
@@ -75,6 +105,114 @@ int sci_status;
 int sci_data;
 
 
+/**
+ * Optional receive hook, called from the SCI interrupt with each received
+ * byte. It returns 0 if it consumed the byte or non-zero to have the
+ * byte stored in the receive FIFO as usual.
+ */
+int (*sci_rx_hook)(int byte);
+
+
+/**
+ * Receive unit modes
+ */
+#define SCI_UNIT_NONE   0	/* plain byte stream */
+#define SCI_UNIT_DELIM  1	/* units end with sci_unit_delim */
+#define SCI_UNIT_LENGTH 2	/* units start with a byte count */
+
+/**
+ * Receive unit mode, one of the SCI_UNIT_ values
+ */
+int sci_unit_mode;
+
+/**
+ * Byte that ends a unit in SCI_UNIT_DELIM mode
+ */
+int sci_unit_delim;
+
+/**
+ * Bytes still due in the current SCI_UNIT_LENGTH unit, -1 while waiting
+ * for the length byte
+ */
+int sci_unit_left = -1;
+
+/**
+ * Receive FIFO position where the unit being received starts
+ */
+unsigned char *sci_unit_start;
+
+/**
+ * Set while the rest of an overrun unit is being thrown away
+ */
+int sci_unit_skip;
+
+/**
+ * Complete units received, counted by the interrupt
+ */
+volatile unsigned int sci_units_in;
+
+/**
+ * Complete units taken by sci_get_unit()
+ */
+unsigned int sci_units_read;
+
+/**
+ * Units lost because the receive FIFO was full
+ */
+int sci_unit_overruns;
+
+
+/**
+ * Store one received byte in unit mode and count completed units. If
+ * the FIFO fills, the partial unit is removed and the rest of it is
+ * thrown away as it arrives, so the FIFO only ever holds whole units
+ * plus the one being received. Called from sci_int().
+ *
+ * @param byte The received byte
+ */
+static void sci_unit_rx(int byte)
+{
+	int end;
+
+	if (sci_unit_skip) {
+		if (sci_unit_mode == SCI_UNIT_DELIM) {
+			if (byte == sci_unit_delim) sci_unit_skip = 0;
+		} else if (--sci_unit_left == 0) {
+			sci_unit_skip = 0;
+			sci_unit_left = -1;
+		}
+		return;
+	}
+
+	/* does this byte complete a unit? */
+	if (sci_unit_mode == SCI_UNIT_DELIM) {
+		end = (byte == sci_unit_delim);
+	} else {
+		if (sci_unit_left < 0)
+			sci_unit_left = byte;	/* length byte */
+		else
+			sci_unit_left--;
+		end = (sci_unit_left == 0);
+	}
+
+	if (qwrite(&rxq,byte) != 0) {		/* full, drop this unit */
+		rxq.in = sci_unit_start;
+		sci_unit_overruns++;
+		if (end)
+			sci_unit_left = -1;
+		else
+			sci_unit_skip = 1;
+		return;
+	}
+
+	if (end) {
+		sci_unit_start = rxq.in;
+		sci_unit_left = -1;
+		sci_units_in++;
+	}
+}
+
+
 /**
  * SCI interrupt service.
  * QSM_SCSR status register
@@ -88,9 +226,13 @@ __attribute__((interrupt_handler)) void sci_int(void)
 	if (sci_status & 0x0040) {	/* RDRF */
 		sci_data = QSM_SCDR;	/* read incoming byte from UART */
 
-		if (qwrite(&rxq,sci_data) != 0) {  /* and write to fifo */
-			qread(&rxq);		/* discard oldest if no room */
-			qwrite(&rxq,sci_data);	/* and try again */
+		if ((sci_rx_hook == 0) || (*sci_rx_hook)(sci_data)) {
+			if (sci_unit_mode) {
+				sci_unit_rx(sci_data);	/* track units */
+			} else if (qwrite(&rxq,sci_data) != 0) {  /* and write to fifo */
+				qread(&rxq);		/* discard oldest if no room */
+				qwrite(&rxq,sci_data);	/* and try again */
+			}
 		}
 	}
 
@@ -113,31 +255,152 @@ __attribute__((interrupt_handler)) void sci_int(void)
 
 
 /**
- * Initializes the QSM SCI interface and FIFOs
+ * Baud rate used by sci_init()
  */
-void sci_init()
+#define SCI_DEFAULT_BAUD 19200
+
+/**
+ * Actual SCI baud rate, set by sci_set_baud()
+ */
+long sci_baud;
+
+/**
+ * Difference between the actual and requested baud rate in tenths of a
+ * percent, set by sci_set_baud(). Keep within about +/-25 (2.5%).
+ */
+int sci_baud_error;
+
+
+/**
+ * Sets the SCI baud rate. The rate is cpu_clock / (32 * SCBR) with SCBR
+ * from 1 to 8191, so at 25.166 MHz the fastest rate is 786432 baud.
+ * 9600 and 19200 are within 0.1%, and 38400, 57600 and 115200 are
+ * within 2.5%, which most PC UARTs tolerate. Rates of 786432 / n, such
+ * as 98304, 196608 and 393216, are exact. Wait for the transmit FIFO to
+ * drain first if the change must not garble output.
+ *
+ * @param baud Requested baud rate
+ * @return The actual baud rate or -1 if baud cannot be generated
+ */
+long sci_set_baud(long baud)
+{
+	extern long cpu_clock;
+	long scbr;
+
+	if (baud <= 0)
+		return -1;
+
+	scbr = (cpu_clock + 16 * baud) / (32 * baud);	/* rounded */
+	if ((scbr < 1) || (scbr > 0x1fff))
+		return -1;
+
+	QSM_SCCR0 = scbr;
+
+	sci_baud = cpu_clock / (32 * scbr);
+	sci_baud_error = ((sci_baud - baud) * 1000) / baud;
+
+	return sci_baud;
+}
+
+
+/**
+ * Initializes the QSM SCI interface and FIFOs at a given baud rate. The
+ * rate error is left in sci_baud_error.
+ *
+ * @param baud Requested baud rate
+ * @return The actual baud rate or -1 if baud cannot be generated, in
+ * which case the rate is left at SCI_DEFAULT_BAUD
+ */
+long sci_init_baud(long baud)
 {
 	extern int vbraddr;
+	long actual;
 
-	q_init(&txq, &tx_buf[0], SCI_BUF_SIZE);
-	q_init(&rxq, &rx_buf[0], SCI_BUF_SIZE);
+	q_init(&txq, sci_tx_buf, sci_tx_size);
+	q_init(&rxq, sci_rx_buf, sci_rx_size);
+	sci_unit_start = rxq.in;		/* unit mode may already be on */
+	sci_unit_left = -1;
+	sci_unit_skip = 0;
+	sci_units_read = sci_units_in;
 
 	*(long*)(vbraddr+(SCIVEC+0)*4) = (long)sci_int;	/* SCI interrupt vector */
-	*(long*)(vbraddr+(SCIVEC+1)*4) = (long)sci_int;	/* why this one also? */
+	*(long*)(vbraddr+(SCIVEC+1)*4) = (long)sci_int;	/* QSPI vector, see qspi_init() */
 
 	QSM_MCR = 0x0087;			/* QSM configuration register */
 						/* 0x0080 is supervisor bit */
 						/* low 4 bits are arbitration # (7) */
 
-	QSM_QILR_QIVR = SCIVEC + 0x0600;	/* low 8 bits are vec #, hi 3 are priority */
-						/* so vec# 0x56, priority 6 */
+	QSM_QILR_QIVR = (QSM_QILR_QIVR & 0x3800) + SCIVEC + 0x0600;
+						/* low 8 bits are vec #, bits 10-8 are */
+						/* SCI priority, so vec# 0x56, priority 6 */
+						/* QSPI priority (bits 13-11) is kept */
 
 
-	QSM_SCCR0 = 41; /* 27 = 19200 baud at 16.778 MHz clock. */
-                   /* 55 = 9600, 109 = 4800 */
+	actual = sci_set_baud(baud);
+	if (actual < 0)
+		sci_set_baud(SCI_DEFAULT_BAUD);
 
 	QSM_SCCR1 = 0x002c;	/* Trans int ena(80) +Rcv int ena(20) +Tran ena (08) +Rcv ena (04) */
 				/* start with trans int enable off (0x80) */
+
+	return actual;
+}
+
+
+/**
+ * Initializes the QSM SCI interface and FIFOs at the default baud rate
+ */
+void sci_init()
+{
+	sci_init_baud(SCI_DEFAULT_BAUD);
+}
+
+
+/**
+ * Replace the SCI FIFO buffers with application supplied ones, so each
+ * can be sized to the real burst profile. May be called before or after
+ * sci_init(). When called after, it waits (calling defer()) for pending
+ * output to be sent, and any unread input is discarded. A FIFO holds one
+ * byte less than its buffer size.
+ *
+ * @param tx Transmit buffer, or 0 for the default tx_buf
+ * @param txsize Size of tx in bytes, at least 2
+ * @param rx Receive buffer, or 0 for the default rx_buf
+ * @param rxsize Size of rx in bytes, at least 2
+ * @return 0 if successful or -1 if a size is too small
+ */
+int sci_set_buffers(char *tx, int txsize, char *rx, int rxsize)
+{
+	if (tx == 0) {
+		tx = tx_buf;
+		txsize = SCI_BUF_SIZE;
+	}
+	if (rx == 0) {
+		rx = rx_buf;
+		rxsize = SCI_BUF_SIZE;
+	}
+	if ((txsize < 2) || (rxsize < 2))
+		return -1;
+
+	sci_tx_buf = tx;
+	sci_tx_size = txsize;
+	sci_rx_buf = rx;
+	sci_rx_size = rxsize;
+
+	if (txq.buf) {				/* already running */
+		while (qstatus(&txq)) defer();	/* let output drain */
+
+		QSM_SCCR1 = 0x000c;		/* both interrupts off */
+		q_init(&txq, sci_tx_buf, sci_tx_size);
+		q_init(&rxq, sci_rx_buf, sci_rx_size);
+		sci_unit_start = rxq.in;	/* no units left */
+		sci_unit_left = -1;
+		sci_unit_skip = 0;
+		sci_units_read = sci_units_in;
+		QSM_SCCR1 = 0x002c;		/* rcv interrupt back on */
+	}
+
+	return 0;
 }
 
 
@@ -158,6 +421,50 @@ int sci_putc(char byte)
 }
 
 
+/**
+ * Copy as much of a buffer as will fit into the SCI transmit FIFO. Bytes
+ * are stored directly behind the FIFO input pointer, which is published
+ * once at the end, and the TDRE interrupt is enabled once per call rather
+ * than once per byte. Never blocks; the caller decides whether to defer()
+ * and call again with the remainder.
+ *
+ * @param buf Pointer to the bytes to be sent
+ * @param nbytes The number of bytes to be sent
+ * @param crlf Non-zero to send each newline (\\n) as a CR/LF pair. A
+ * newline is only consumed when both bytes fit.
+ * @return Number of bytes consumed from buf (0 if the FIFO is full)
+ */
+int sci_write(char *buf, int nbytes, int crlf)
+{
+	unsigned char *in;
+	int room, i;
+
+	/* free space only grows while we work, as the ISR drains the FIFO */
+	room = txq.size - 1 - qstatus(&txq);
+	in = txq.in;
+
+	for (i = 0; i < nbytes; i++) {
+		if (crlf && (buf[i] == 10)) {
+			if (room < 2) break;
+			*in = 13;
+			if (++in >= txq.end) in = txq.buf;
+			room--;
+		}
+		if (room < 1) break;
+		*in = buf[i];
+		if (++in >= txq.end) in = txq.buf;
+		room--;
+	}
+
+	if (i) {
+		txq.in = in;		/* publish the new bytes to the ISR */
+		QSM_SCCR1 = 0x00ac;	/* TDRE interrupt on */
+	}
+
+	return (i);
+}
+
+
 /**
  * Read one byte from SCI UART receive buffer 
  *
@@ -169,6 +476,206 @@ int sci_getc()
 }
 
 
+/**
+ * Give the receive FIFO space up to out back to the interrupt, after
+ * reading from start. Interrupts are masked meanwhile. When the FIFO is
+ * full the interrupt drops the oldest byte by moving rxq.out on, so if
+ * it has got further than out while the caller was reading, its position
+ * is kept; storing out would make a full FIFO look empty or repeat
+ * bytes.
+ */
+static void sci_rx_release(unsigned char *start, unsigned char *out)
+{
+	unsigned short sr;
+	int size, ours, theirs;
+
+	asm volatile ("move.w %%sr,%0\n\tori.w #0x0700,%%sr"
+		: "=d" (sr) : : "memory");
+
+	size = rxq.end - rxq.buf;
+	ours = (out - start + size) % size;
+	theirs = (rxq.out - start + size) % size;
+	if (ours > theirs)
+		rxq.out = out;
+
+	asm volatile ("move.w %0,%%sr" : : "d" (sr) : "memory");
+}
+
+
+/**
+ * Copy whatever is waiting in the SCI receive FIFO, up to nbytes, into a
+ * buffer. Never blocks.
+ *
+ * @param buf Pointer to the destination buffer
+ * @param nbytes Size of the destination buffer
+ * @return Number of bytes copied, 0 if nothing was waiting
+ */
+int sci_read(char *buf, int nbytes)
+{
+	unsigned char *start, *out, *in;
+	int i;
+
+	in = rxq.in;		/* snapshot, the ISR may append behind us */
+	out = start = rxq.out;
+
+	for (i = 0; (i < nbytes) && (out != in); i++) {
+		buf[i] = *out;
+		if (++out >= rxq.end) out = rxq.buf;
+	}
+
+	if (i)
+		sci_rx_release(start, out);	/* release the space */
+
+	return (i);
+}
+
+
+/**
+ * Read from the SCI receive FIFO until nbytes have arrived or a timeout
+ * expires, calling defer() while waiting.
+ *
+ * @param buf Pointer to the destination buffer
+ * @param nbytes The number of bytes wanted
+ * @param timeout Maximum wait in milliseconds. 0 returns at once with
+ * whatever is waiting, a negative value waits forever.
+ * @return Number of bytes copied, which is less than nbytes on timeout
+ */
+int sci_read_timed(char *buf, int nbytes, long timeout)
+{
+	extern long sysclock;
+	long t;
+	int i;
+
+	t = sysclock + timeout;
+	i = sci_read(buf, nbytes);
+
+	while (i < nbytes) {
+		if ((timeout >= 0) && (sysclock >= t)) break;
+		defer();
+		i += sci_read(buf + i, nbytes - i);
+	}
+
+	return (i);
+}
+
+
+/**
+ * Set the receive unit mode. Unread input is discarded.
+ */
+static void sci_unit_set(int mode, int delim)
+{
+	sci_unit_mode = SCI_UNIT_NONE;		/* the ISR stores plain bytes */
+	sci_unit_delim = delim;
+	sci_unit_left = -1;
+	sci_unit_skip = 0;
+	rxq.out = rxq.in;			/* flush */
+	sci_unit_start = rxq.in;
+	sci_units_read = sci_units_in;
+	sci_unit_mode = mode;
+}
+
+
+/**
+ * Make received data a series of units ending with a delimiter byte, for
+ * example 13 for command lines. The receive interrupt counts complete
+ * units, so a consumer only needs to look at the data once a whole
+ * unit has arrived. Use sci_get_unit() or sci_wait_unit() rather than
+ * sci_getc() or sci_read() while unit mode is on. Unread input is
+ * discarded.
+ *
+ * @param delim The byte that ends each unit, or -1 to return to a plain
+ * byte stream
+ */
+void sci_set_delimiter(int delim)
+{
+	if (delim < 0)
+		sci_unit_set(SCI_UNIT_NONE, 0);
+	else
+		sci_unit_set(SCI_UNIT_DELIM, delim & 0xff);
+}
+
+
+/**
+ * Make received data a series of units, each a byte count (0 to 255)
+ * followed by that many bytes. Otherwise as sci_set_delimiter(). A unit
+ * must fit in the receive FIFO, see sci_set_buffers().
+ */
+void sci_set_length_prefix(void)
+{
+	sci_unit_set(SCI_UNIT_LENGTH, 0);
+}
+
+
+/**
+ * Number of complete units waiting in the receive FIFO
+ *
+ * @return Unit count, 0 if none
+ */
+int sci_units(void)
+{
+	return (int)(sci_units_in - sci_units_read);
+}
+
+
+/**
+ * Copy the next complete unit out of the receive FIFO in one pass. The
+ * delimiter or length byte is not copied. A unit longer than the buffer
+ * is truncated and the rest of it discarded.
+ *
+ * @param buf Pointer to the destination buffer
+ * @param max Size of buf
+ * @return Number of bytes copied or -1 if no complete unit is waiting
+ */
+int sci_get_unit(char *buf, int max)
+{
+	unsigned char *start, *out;
+	int c, n, len;
+
+	if (sci_units_in == sci_units_read)
+		return -1;
+
+	out = start = rxq.out;
+	n = 0;
+
+	if (sci_unit_mode == SCI_UNIT_DELIM) {
+		while (1) {
+			c = *out;
+			if (++out >= rxq.end) out = rxq.buf;
+			if (c == sci_unit_delim) break;
+			if (n < max) buf[n++] = c;
+		}
+	} else {
+		len = *out;
+		if (++out >= rxq.end) out = rxq.buf;
+		while (len-- > 0) {
+			c = *out;
+			if (++out >= rxq.end) out = rxq.buf;
+			if (n < max) buf[n++] = c;
+		}
+	}
+
+	sci_rx_release(start, out);	/* release the space */
+	sci_units_read++;
+
+	return n;
+}
+
+
+/**
+ * Wait for the next complete unit, calling defer() while waiting, and
+ * copy it out as sci_get_unit() does
+ *
+ * @param buf Pointer to the destination buffer
+ * @param max Size of buf
+ * @return Number of bytes copied
+ */
+int sci_wait_unit(char *buf, int max)
+{
+	while (sci_units_in == sci_units_read) defer();
+	return sci_get_unit(buf, max);
+}
+
+
 /**
  * hook for libdprg.a debug() I/O
  */
@@ -15,6 +15,8 @@
  *
  * 30 Dec 2006 rsr - Normalized indentation
  *
+ * 18 Oct 2026 agt - Added call to crc_init()
+ *
  * \todo system_init() should accept an initial clock speed value and
  * pass it to cpu_init()
  */
@@ -56,6 +58,7 @@ int system_init()
 	lcd_init(); 
 	sci_init(); 
 	tpu_init(0x06);   /* iarb = 6 */
+	crc_init();       /* build run-time CRC tables */
 	analog_service(); /* init analog read */
 
 	/* set hook to 1Kz sysclock interrupt for LCD and A/D service */
@@ -0,0 +1,216 @@
+/**
+ * \file telemetry.c
+ * \brief Framed binary telemetry link over the SCI
+ *
+ * Sends and receives the CRC checked, COBS framed packets built by
+ * tlm_frame.c. Binary frames carry several times more samples per
+ * second than printf() text at the same baud rate and need no
+ * formatting on the robot.
+ *
+ * Transmit frames are copied into the SCI FIFO with sci_write(). A task
+ * that blocks in tlm_send() waiting for FIFO space can have its frame
+ * interleaved with output from other tasks, so keep one task per link.
+ *
+ * Reception is off by default. Once tlm_rx_enable() is called every byte
+ * received by the SCI is treated as part of a frame: the SCI interrupt
+ * collects bytes until a zero delimiter and then hands the whole frame
+ * to tlm_receive() or tlm_wait() by swapping buffers, so the receive
+ * FIFO and sci_getc() no longer see the data. A frame that arrives while
+ * the previous one is still unread is dropped and counted.
+ *
+ * A host side decoder is in tools/tlm_decode.c.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "telemetry.h"
+
+/**
+ * Receive frame buffers. The interrupt fills one while a task decodes
+ * the other.
+ */
+unsigned char tlm_buf_a[TLM_MAX_ENCODED], tlm_buf_b[TLM_MAX_ENCODED];
+
+/**
+ * Buffer being filled by the SCI interrupt
+ */
+unsigned char *tlm_rx_acc = tlm_buf_a;
+
+/**
+ * Number of bytes collected in tlm_rx_acc so far
+ */
+int tlm_rx_count;
+
+/**
+ * Set when the frame being collected is too long, so that it is dropped
+ */
+int tlm_rx_overrun;
+
+/**
+ * Complete received frame waiting for a task
+ */
+unsigned char * volatile tlm_rx_frame;
+
+/**
+ * Length of tlm_rx_frame, 0 when no frame is waiting
+ */
+volatile int tlm_rx_len;
+
+/**
+ * Number of received frames dropped because the previous one was unread
+ * or the frame was too long
+ */
+int tlm_rx_dropped;
+
+/**
+ * Number of received frames that failed COBS decoding or the CRC check
+ */
+int tlm_rx_errors;
+
+/**
+ * Sequence number of the next transmitted frame
+ */
+unsigned char tlm_tx_seq;
+
+
+/**
+ * Build a frame and queue it for transmission, calling defer() while
+ * the SCI transmit FIFO is full.
+ *
+ * @param type Payload type, one of the TLM_TYPE_ values
+ * @param payload Pointer to the payload bytes
+ * @param len Number of payload bytes, at most TLM_MAX_PAYLOAD
+ * @return The number of payload bytes sent or -1 if len is too big
+ */
+int tlm_send(int type, unsigned char *payload, int len)
+{
+	unsigned char buf[TLM_MAX_ENCODED + 1];
+	int i, n;
+
+	n = tlm_frame_encode(type, tlm_tx_seq, payload, len, buf);
+	if (n < 0)
+		return -1;
+	tlm_tx_seq++;
+
+	i = 0;
+	while (1) {
+		i += sci_write((char *)buf + i, n - i, 0);
+		if (i >= n) break;
+		defer();
+	}
+
+	return len;
+}
+
+
+/**
+ * SCI receive hook. Runs in the SCI interrupt and collects bytes until
+ * a frame delimiter arrives.
+ *
+ * @param byte The received byte
+ * @return Always 0, the byte is never passed on to the receive FIFO
+ */
+int tlm_rx_byte(int byte)
+{
+	if (byte == TLM_DELIM) {
+		if ((tlm_rx_count > 0) && (tlm_rx_overrun == 0)) {
+			if (tlm_rx_len == 0) {
+				tlm_rx_frame = tlm_rx_acc;
+				tlm_rx_len = tlm_rx_count;
+				tlm_rx_acc = (tlm_rx_acc == tlm_buf_a) ?
+					tlm_buf_b : tlm_buf_a;
+			} else {
+				tlm_rx_dropped++;
+			}
+		} else if (tlm_rx_overrun) {
+			tlm_rx_dropped++;
+		}
+		tlm_rx_count = 0;
+		tlm_rx_overrun = 0;
+	} else if (tlm_rx_count < TLM_MAX_ENCODED) {
+		tlm_rx_acc[tlm_rx_count++] = byte;
+	} else {
+		tlm_rx_overrun = 1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Turn frame reception on or off. While on, all received SCI bytes are
+ * taken by the telemetry link instead of the receive FIFO.
+ *
+ * @param enable Non-zero to enable reception
+ */
+void tlm_rx_enable(int enable)
+{
+	extern int (*sci_rx_hook)(int byte);
+
+	sci_rx_hook = 0;
+	tlm_rx_count = 0;
+	tlm_rx_overrun = 0;
+	tlm_rx_len = 0;
+	if (enable)
+		sci_rx_hook = tlm_rx_byte;
+}
+
+
+/**
+ * Fetch the next received frame if one is waiting. Never blocks.
+ * Frames that fail their CRC are counted in tlm_rx_errors and skipped.
+ *
+ * @param f Pointer to the frame struct to fill in
+ * @return Payload length or -1 if no good frame is waiting
+ */
+int tlm_receive(struct tlm_frame *f)
+{
+	int n;
+
+	if (tlm_rx_len == 0)
+		return -1;
+
+	n = tlm_frame_decode(tlm_rx_frame, tlm_rx_len, f);
+	tlm_rx_len = 0;		/* hand the buffer back to the interrupt */
+
+	if (n < 0)
+		tlm_rx_errors++;
+
+	return n;
+}
+
+
+/**
+ * Wait for the next good frame, calling defer() while waiting
+ *
+ * @param f Pointer to the frame struct to fill in
+ * @return Payload length
+ */
+int tlm_wait(struct tlm_frame *f)
+{
+	int n;
+
+	while ((n = tlm_receive(f)) < 0)
+		defer();
+
+	return n;
+}
@@ -0,0 +1,106 @@
+/**
+ * \file tlm_frame.c
+ * \brief Telemetry frame encoding and decoding
+ *
+ * Builds and checks the frames used by the telemetry link in
+ * telemetry.c. A frame is a type byte, a sequence number, up to
+ * TLM_MAX_PAYLOAD payload bytes and a big-endian CRC-16/CCITT of all of
+ * them, COBS encoded so that the only zero byte on the wire is the
+ * delimiter that ends each frame.
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "crc.h"
+#include "telemetry.h"
+
+
+/**
+ * Build a complete frame, including the trailing zero delimiter
+ *
+ * @param type Payload type, one of the TLM_TYPE_ values
+ * @param seq Sequence number, only the low 8 bits are sent
+ * @param payload Pointer to the payload bytes
+ * @param len Number of payload bytes, at most TLM_MAX_PAYLOAD
+ * @param dst Output buffer of at least TLM_MAX_ENCODED + 1 bytes
+ * @return Number of bytes written to dst or -1 if len is too big
+ */
+int tlm_frame_encode(int type, int seq, unsigned char *payload, int len,
+	unsigned char *dst)
+{
+	unsigned char raw[TLM_MAX_FRAME];
+	unsigned short crc;
+	int i, n;
+
+	if ((len < 0) || (len > TLM_MAX_PAYLOAD))
+		return -1;
+
+	raw[0] = type;
+	raw[1] = seq;
+	for (i = 0; i < len; i++)
+		raw[i + 2] = payload[i];
+
+	crc = crc16_update(CRC16_INIT, raw, len + 2);
+	raw[len + 2] = crc >> 8;
+	raw[len + 3] = crc;
+
+	n = cobs_encode(raw, len + 4, dst);
+	dst[n++] = TLM_DELIM;
+
+	return n;
+}
+
+
+/**
+ * Decode and check one received frame
+ *
+ * @param src Pointer to the encoded bytes, without the delimiter
+ * @param nbytes Number of bytes in src
+ * @param f Pointer to the frame struct to fill in
+ * @return Payload length or -1 if the frame is malformed or fails its CRC
+ */
+int tlm_frame_decode(unsigned char *src, int nbytes, struct tlm_frame *f)
+{
+	unsigned char raw[TLM_MAX_ENCODED];
+	unsigned short crc;
+	int i, n;
+
+	if ((nbytes < 1) || (nbytes > TLM_MAX_ENCODED))
+		return -1;
+
+	n = cobs_decode(src, nbytes, raw);
+	if ((n < 4) || (n > TLM_MAX_FRAME))
+		return -1;
+
+	crc = crc16_update(CRC16_INIT, raw, n - 2);
+	if ((raw[n - 2] != (unsigned char)(crc >> 8)) ||
+	    (raw[n - 1] != (unsigned char)crc))
+		return -1;
+
+	f->type = raw[0];
+	f->seq = raw[1];
+	f->len = n - 4;
+	for (i = 0; i < f->len; i++)
+		f->payload[i] = raw[i + 2];
+
+	return f->len;
+}
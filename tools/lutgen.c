@@ -0,0 +1,104 @@
+/**
+ * \file lutgen.c
+ * \brief Host side generator for A/D linearisation tables
+ *
+ * Reads sensor measurements as CSV lines "raw,value" from the file
+ * named by the second argument, or stdin if there is none, where raw is
+ * the 0-255 A/D reading and value the measured quantity in the units
+ * wanted on the robot (mm, mV, ...). Lines that do not start with a
+ * number, such as a header, are skipped. Readings taken more than once
+ * are averaged. Prints C source for a 256 entry table,
+ * interpolated linearly between the measurements by analog_lut_build(),
+ * to be compiled into the robot code and set with analog_set_lut(). The
+ * first argument names the table:
+ *
+ *   tools/lutgen sharp_left left.csv > sharp_left.c
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ * 18 Oct 2026 agt - Read the measurements from a named file
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <stdio.h>
+#include "analog.h"
+
+int main(int argc, char *argv[])
+{
+	static double sum[ANALOG_LUT_SIZE];
+	static int count[ANALOG_LUT_SIZE];
+	struct analog_point p[ANALOG_LUT_SIZE];
+	short lut[ANALOG_LUT_SIZE];
+	char line[256];
+	char *name;
+	FILE *in;
+	double value;
+	int raw, n, i;
+
+	name = (argc > 1) ? argv[1] : "analog_table";
+
+	in = stdin;
+	if (argc > 2) {
+		in = fopen(argv[2], "r");
+		if (in == NULL) {
+			perror(argv[2]);
+			return 1;
+		}
+	}
+
+	while (fgets(line, sizeof(line), in)) {
+		if (sscanf(line, "%d ,%lf", &raw, &value) != 2)
+			continue;
+		if ((raw < 0) || (raw >= ANALOG_LUT_SIZE)) {
+			fprintf(stderr, "lutgen: reading %d out of range\n", raw);
+			return 1;
+		}
+		sum[raw] += value;
+		count[raw]++;
+	}
+
+	for (raw = n = 0; raw < ANALOG_LUT_SIZE; raw++) {
+		if (count[raw] == 0)
+			continue;
+		value = sum[raw] / count[raw];
+		if ((value < -32768.0) || (value > 32767.0)) {
+			fprintf(stderr, "lutgen: value %g does not fit\n", value);
+			return 1;
+		}
+		p[n].raw = raw;
+		p[n].value = (value < 0) ? (int)(value - 0.5) : (int)(value + 0.5);
+		n++;
+	}
+
+	if (analog_lut_build(p, n, lut)) {
+		fprintf(stderr, "lutgen: no measurements\n");
+		return 1;
+	}
+
+	printf("/* generated by lutgen from %d measured readings */\n\n", n);
+	printf("const short %s[%d] = {", name, ANALOG_LUT_SIZE);
+	for (i = 0; i < ANALOG_LUT_SIZE; i++)
+		printf("%s%6d%s", (i % 8) ? "" : "\n\t", lut[i],
+			(i < ANALOG_LUT_SIZE - 1) ? "," : "");
+	printf("\n};\n");
+
+	return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * \file tlm_decode.c
+ * \brief Host side decoder for the libdprg telemetry link
+ *
+ * Reads a raw byte stream captured from the robot's serial port, from a
+ * file or stdin, splits it into frames and prints one line per frame:
+ * sequence number, type, length and the payload. TEXT frames print as
+ * text and SHORTS/LONGS frames as signed decimal words, everything else
+ * as hex. WATCH frames are printed as name=value pairs using the names
+ * learned from WATCH_LIST frames (see watch.c). SCOPE frames are printed
+ * as sample index and one value per channel. Bad frames and gaps in
+ * the sequence numbers are reported.
+ *
+ * Build with "make tools" on the host, then for example
+ *
+ *   stty -F /dev/ttyUSB0 raw 19200; tools/tlm_decode < /dev/ttyUSB0
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ * 18 Oct 2026 agt - Decode watch frames
+ *
+ * 18 Oct 2026 agt - Decode A/D scope frames
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "telemetry.h"
+#include "watch.h"
+
+/**
+ * Watch variables learned from WATCH_LIST frames
+ */
+static struct {
+	int type;
+	char name[TLM_MAX_PAYLOAD];
+} vars[WATCH_MAX];
+
+
+/**
+ * Read a big-endian value of 1, 2 or 4 bytes
+ */
+static long get_value(unsigned char *p, int type)
+{
+	unsigned long v;
+	int i, size;
+
+	size = WATCH_SIZE(type);
+	v = 0;
+	for (i = 0; i < size; i++)
+		v = (v << 8) | p[i];
+
+	if (WATCH_SIGNED(type) && (size < 4) && (v & (1UL << (size * 8 - 1))))
+		v -= 1UL << (size * 8);
+	else if (WATCH_SIGNED(type) && (size == 4))
+		return (long)(int)v;
+
+	return (long)v;
+}
+
+
+/**
+ * Print a WATCH frame: timestamp, selection mask, then the values
+ */
+static void print_watch(struct tlm_frame *f)
+{
+	unsigned long mask;
+	int i, n;
+
+	if (f->len < 8)
+		return;
+
+	printf(" t=%ld", get_value(f->payload, WATCH_LONG));
+	mask = get_value(f->payload + 4, WATCH_ULONG) & 0xffffffffUL;
+	n = 8;
+	for (i = 0; i < WATCH_MAX; i++) {
+		if (!(mask & (1UL << i)))
+			continue;
+		if ((vars[i].type == 0) ||
+		    (n + WATCH_SIZE(vars[i].type) > f->len)) {
+			printf(" (variable %d unknown, send \"watch list\")", i);
+			return;
+		}
+		printf(" %s=%ld", vars[i].name, get_value(f->payload + n,
+			vars[i].type));
+		n += WATCH_SIZE(vars[i].type);
+	}
+}
+
+
+/**
+ * Print a SCOPE frame: channel mask, then index:value,value... for each
+ * sample, the trigger sample being index 0
+ */
+static void print_scope(struct tlm_frame *f)
+{
+	int nch, idx, i, j;
+
+	if (f->len < 3)
+		return;
+
+	for (i = nch = 0; i < 8; i++)
+		if (f->payload[0] & (1 << i))
+			nch++;
+	if (nch == 0)
+		return;
+
+	idx = (short)((f->payload[1] << 8) | f->payload[2]);
+	printf(" ch %02x", f->payload[0]);
+	for (i = 3; i + nch <= f->len; i += nch, idx++) {
+		printf(" %d:", idx);
+		for (j = 0; j < nch; j++)
+			printf("%s%d", j ? "," : "", f->payload[i + j]);
+	}
+}
+
+
+/**
+ * Print one decoded frame
+ */
+static void print_frame(struct tlm_frame *f)
+{
+	int i;
+
+	printf("%3d %02x %2d:", f->seq, f->type, f->len);
+
+	switch (f->type) {
+	case TLM_TYPE_TEXT:
+		printf(" \"");
+		for (i = 0; i < f->len; i++)
+			putchar(f->payload[i]);
+		printf("\"");
+		break;
+	case TLM_TYPE_SHORTS:
+		for (i = 0; i + 1 < f->len; i += 2)
+			printf(" %d", (short)((f->payload[i] << 8) |
+				f->payload[i + 1]));
+		break;
+	case TLM_TYPE_LONGS:
+		for (i = 0; i + 3 < f->len; i += 4)
+			printf(" %ld", (long)(int)(((unsigned)f->payload[i] << 24) |
+				(f->payload[i + 1] << 16) |
+				(f->payload[i + 2] << 8) | f->payload[i + 3]));
+		break;
+	case TLM_TYPE_WATCH_LIST:
+		if ((f->len >= 2) && (f->payload[0] < WATCH_MAX)) {
+			i = f->payload[0];
+			vars[i].type = f->payload[1];
+			memcpy(vars[i].name, f->payload + 2, f->len - 2);
+			vars[i].name[f->len - 2] = 0;
+			printf(" %d %s type %02x", i, vars[i].name, vars[i].type);
+		}
+		break;
+	case TLM_TYPE_WATCH:
+		print_watch(f);
+		break;
+	case TLM_TYPE_SCOPE:
+		print_scope(f);
+		break;
+	default:
+		for (i = 0; i < f->len; i++)
+			printf(" %02x", f->payload[i]);
+		break;
+	}
+	printf("\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	unsigned char buf[TLM_MAX_ENCODED];
+	struct tlm_frame f;
+	FILE *in;
+	int c, n, overrun, expect;
+	long good, bad, lost;
+
+	in = stdin;
+	if (argc > 1) {
+		in = fopen(argv[1], "rb");
+		if (in == NULL) {
+			perror(argv[1]);
+			return 1;
+		}
+	}
+
+	n = overrun = 0;
+	expect = -1;
+	good = bad = lost = 0;
+
+	while ((c = getc(in)) != EOF) {
+		if (c != TLM_DELIM) {
+			if (n < TLM_MAX_ENCODED)
+				buf[n++] = c;
+			else
+				overrun = 1;
+			continue;
+		}
+		if (n == 0)
+			continue;
+
+		if (overrun || (tlm_frame_decode(buf, n, &f) < 0)) {
+			printf("bad frame (%d bytes)\n", n);
+			bad++;
+		} else {
+			if ((expect >= 0) && (f.seq != expect)) {
+				printf("lost %d frame(s)\n", (f.seq - expect) & 0xff);
+				lost += (f.seq - expect) & 0xff;
+			}
+			expect = (f.seq + 1) & 0xff;
+			print_frame(&f);
+			good++;
+		}
+		fflush(stdout);
+		n = overrun = 0;
+	}
+
+	fprintf(stderr, "%ld good, %ld bad, %ld lost\n", good, bad, lost);
+	return 0;
+}
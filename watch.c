@@ -0,0 +1,371 @@
+/**
+ * \file watch.c
+ * \brief Live variable watch and periodic telemetry streamer
+ *
+ * Lets the application name its interesting variables once, for example
+ *
+ *   watch_register("left_velocity", WATCH_INT, &left_velocity);
+ *   watch_register("an0", WATCH_INT, &an0);
+ *   watch_register("sysclock", WATCH_LONG, &sysclock);
+ *   watch_start(20, 1);
+ *
+ * and then choose at run time which of them are streamed, and how
+ * often, without a rebuild. Samples go out as binary telemetry frames
+ * (see telemetry.c) that tools/tlm_decode prints by name.
+ *
+ * A TLM_TYPE_WATCH frame holds a 32 bit sysclock timestamp, the 32 bit
+ * selection mask and then each selected variable at its own size, in
+ * index order. When a variable is added to the selection a
+ * TLM_TYPE_WATCH_LIST frame gives its index, type and name so the host
+ * can decode the samples. Values are read without locking, which is safe
+ * for the aligned 8, 16 and 32 bit variables this is meant for.
+ *
+ * Commands are lines of text. They are read from the SCI receive FIFO
+ * by the streamer task if watch_start() was told to listen, or can be
+ * passed in by an application's own command parser with
+ * watch_command():
+ *
+ *   watch add NAME    start streaming NAME
+ *   watch del NAME    stop streaming NAME
+ *   watch clear       stop streaming everything
+ *   watch rate MS     sample every MS milliseconds, 0 to pause
+ *   watch list        send the list frames for all registered variables
+ *
+ * <b>History:</b>
+ *
+ * 18 Oct 2026 agt - Created
+ *
+ */
+
+/*
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <string.h>
+#include "telemetry.h"
+#include "watch.h"
+
+/**
+ * Maximum length of a command line
+ */
+#define WATCH_LINE_SIZE 40
+
+/**
+ * Registered variables
+ */
+struct watch_var watch_vars[WATCH_MAX];
+
+/**
+ * Number of registered variables
+ */
+int watch_count;
+
+/**
+ * Bit mask of the variables being streamed, bit n = watch_vars[n]
+ */
+unsigned long watch_mask;
+
+/**
+ * Payload bytes used by the timestamp and selection mask
+ */
+#define WATCH_HEADER 8
+
+/**
+ * Payload bytes used by the selected variables, including the header
+ */
+int watch_bytes = WATCH_HEADER;
+
+/**
+ * Sampling period in milliseconds, 0 = paused
+ */
+int watch_period;
+
+/**
+ * Bit mask of the variables whose list frames still need to be sent
+ */
+unsigned long watch_list_pending;
+
+
+/**
+ * Add a variable to the registry. Names are not copied, so pass string
+ * constants.
+ *
+ * @param name Name used in commands and by the host decoder
+ * @param type One of the WATCH_ types
+ * @param addr Address of the variable
+ * @return The variable's index or -1 if the registry is full
+ */
+int watch_register(const char *name, int type, volatile void *addr)
+{
+	if (watch_count >= WATCH_MAX)
+		return -1;
+
+	watch_vars[watch_count].name = name;
+	watch_vars[watch_count].type = type;
+	watch_vars[watch_count].addr = addr;
+
+	return watch_count++;
+}
+
+
+/**
+ * Look up a registered variable by name
+ *
+ * @param name Variable name
+ * @return The variable's index or -1 if it is not registered
+ */
+int watch_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < watch_count; i++) {
+		if (strcmp(watch_vars[i].name, name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+
+/**
+ * Start or stop streaming a variable
+ *
+ * @param name Variable name
+ * @param on Non-zero to start streaming, zero to stop
+ * @return 0 if successful or -1 if the name is unknown or the variable
+ * would not fit in a frame with those already selected
+ */
+int watch_select(const char *name, int on)
+{
+	unsigned long bit;
+	int i, size;
+
+	if ((i = watch_find(name)) < 0)
+		return -1;
+
+	bit = 1UL << i;
+	size = WATCH_SIZE(watch_vars[i].type);
+
+	if (on && !(watch_mask & bit)) {
+		if (watch_bytes + size > TLM_MAX_PAYLOAD)
+			return -1;
+		watch_bytes += size;
+		watch_mask |= bit;
+		watch_list_pending |= bit;
+	} else if (!on && (watch_mask & bit)) {
+		watch_bytes -= size;
+		watch_mask &= ~bit;
+	}
+
+	return 0;
+}
+
+
+/**
+ * Set the sampling period
+ *
+ * @param period Milliseconds between samples, 0 to pause streaming
+ */
+void watch_rate(int period)
+{
+	if (period < 0) period = 0;
+	watch_period = period;
+}
+
+
+/**
+ * Split the next space separated word off a line
+ *
+ * @param p Pointer to the line pointer, advanced past the word
+ * @return The word, or an empty string if there is none
+ */
+static char *watch_word(char **p)
+{
+	char *s, *w;
+
+	s = *p;
+	while (*s == ' ') s++;
+	w = s;
+	while (*s && (*s != ' ')) s++;
+	if (*s) *s++ = 0;
+	*p = s;
+
+	return w;
+}
+
+
+/**
+ * Carry out a watch command. The line is modified.
+ *
+ * @param line A command line, see the file description
+ * @return 0 if the command was carried out or -1 if it is not a watch
+ * command or failed
+ */
+int watch_command(char *line)
+{
+	char *w, *arg;
+	int n;
+
+	if (strcmp(watch_word(&line), "watch") != 0)
+		return -1;
+
+	w = watch_word(&line);
+	arg = watch_word(&line);
+
+	if (strcmp(w, "add") == 0)
+		return watch_select(arg, 1);
+
+	if (strcmp(w, "del") == 0)
+		return watch_select(arg, 0);
+
+	if (strcmp(w, "clear") == 0) {
+		watch_mask = 0;
+		watch_bytes = WATCH_HEADER;
+		return 0;
+	}
+
+	if (strcmp(w, "rate") == 0) {
+		n = 0;
+		while ((*arg >= '0') && (*arg <= '9'))
+			n = n * 10 + (*arg++ - '0');
+		watch_rate(n);
+		return 0;
+	}
+
+	if (strcmp(w, "list") == 0) {
+		if (watch_count)
+			watch_list_pending = 0xffffffffUL >> (32 - watch_count);
+		return 0;
+	}
+
+	return -1;
+}
+
+
+/**
+ * Send one pending list frame, if any
+ */
+static void watch_send_list(void)
+{
+	unsigned char buf[TLM_MAX_PAYLOAD];
+	const char *s;
+	int i, n;
+
+	for (i = 0; i < watch_count; i++) {
+		if (watch_list_pending & (1UL << i))
+			break;
+	}
+	if (i == watch_count) {
+		watch_list_pending = 0;
+		return;
+	}
+	watch_list_pending &= ~(1UL << i);
+
+	buf[0] = i;
+	buf[1] = watch_vars[i].type;
+	n = 2;
+	for (s = watch_vars[i].name; *s && (n < TLM_MAX_PAYLOAD); s++)
+		buf[n++] = *s;
+
+	tlm_send(TLM_TYPE_WATCH_LIST, buf, n);
+}
+
+
+/**
+ * Sample the selected variables and send them in one frame
+ */
+static void watch_send_sample(void)
+{
+	extern long sysclock;
+	unsigned char buf[TLM_MAX_PAYLOAD];
+	unsigned char *p, *v;
+	int i, n, size;
+
+	p = buf;
+	v = (unsigned char *)&sysclock;		/* CPU32 is big-endian */
+	for (n = 0; n < 4; n++)
+		*p++ = v[n];
+	v = (unsigned char *)&watch_mask;
+	for (n = 0; n < 4; n++)
+		*p++ = v[n];
+
+	for (i = 0; i < watch_count; i++) {
+		if (watch_mask & (1UL << i)) {
+			size = WATCH_SIZE(watch_vars[i].type);
+			v = (unsigned char *)watch_vars[i].addr;
+			for (n = 0; n < size; n++)
+				*p++ = v[n];
+		}
+	}
+
+	tlm_send(TLM_TYPE_WATCH, buf, p - buf);
+}
+
+
+/**
+ * Streamer task. Reads commands if asked to, sends list frames as they
+ * become due and samples the selected variables every watch_period ms.
+ *
+ * @param listen Non-zero to read watch commands from the SCI
+ */
+void watch_task(int listen)
+{
+	extern long sysclock;
+	char line[WATCH_LINE_SIZE];
+	long next;
+	int n;
+	char c;
+
+	n = 0;
+	next = sysclock;
+
+	while (1) {
+		while (listen && (sci_read(&c, 1) == 1)) {
+			if ((c == 13) || (c == 10)) {
+				line[n] = 0;
+				if (n) watch_command(line);
+				n = 0;
+			} else if (n < WATCH_LINE_SIZE - 1) {
+				line[n++] = c;
+			}
+		}
+
+		if (watch_list_pending) {
+			watch_send_list();
+		} else if (watch_period && watch_mask && (sysclock >= next)) {
+			watch_send_sample();
+			next += watch_period;
+			if (next <= sysclock)		/* fell behind, skip */
+				next = sysclock + watch_period;
+		}
+
+		defer();
+	}
+}
+
+
+/**
+ * Create the streamer task. Call after registering the variables.
+ *
+ * @param period Initial sampling period in milliseconds, 0 = paused
+ * @param listen Non-zero to have the task read watch commands from the
+ * SCI receive FIFO. Leave zero if another task reads the SCI, and pass
+ * its command lines to watch_command() instead.
+ * @return The process ID of the streamer task
+ */
+int watch_start(int period, int listen)
+{
+	watch_rate(period);
+	return create_task(watch_task, listen, 512);
+}
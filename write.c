@@ -13,6 +13,9 @@
  *
  * 09 Oct 2004 dpa - Created
  *
+ * 18 Oct 2026 agt - stdout goes to the SCI FIFO a buffer at a time through
+ *                   sci_write() and only blocks while the FIFO is full.
+ *
  */
 
 /*
@@ -50,10 +53,14 @@
 
 /* extern int  _EXFUN (outbyte, (char x)); */
 extern int  _EXFUN (mrm_putc, (int fd, char x));
+extern int  _EXFUN (sci_write, (char *buf, int nbytes, int crlf));
+extern void _EXFUN (defer, (void));
 
 
 /**
- * Writes bytes to the output FIFO.
+ * Writes bytes to the output FIFO. Serial output is copied into the SCI
+ * FIFO as a block with newlines expanded to CR/LF, calling defer() only
+ * while the FIFO is full. LCD output still goes a byte at a time.
  *
  * @param fd 1 = stdout = serial UART or 2 = stderr = LCD
  * @param buf Pointer to buffer containing bytes to written
@@ -68,8 +75,17 @@ _DEFUN (write, (fd, buf, nbytes),
 {
   int i;
 
-  for (i = 0; i < nbytes; i++) {
-    mrm_putc (fd, *(buf + i));
+  if (fd == 2) {
+    for (i = 0; i < nbytes; i++) {
+      mrm_putc (fd, *(buf + i));
+    }
+  } else {
+    i = 0;
+    while (1) {
+      i += sci_write (buf + i, nbytes - i, 1);
+      if (i >= nbytes) break;
+      defer ();
+    }
   }
   return (nbytes);
 }